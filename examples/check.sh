@@ -0,0 +1,25 @@
+#!/bin/bash
+# прогоняет примеры: <имя>.txt исполняется как программа, <имя>.repl подаётся на вход --repl;
+# вывод вместе с ошибками сравнивается с <имя>.out, ввод программы берётся из <имя>.in, если он есть;
+# импортируемые примерами модули лежат в modules/
+program=$(realpath "${1:-bin/program}")
+cd "$(dirname "$0")"
+failed=0
+for case in *.txt *.repl; do
+    [ -e "$case" ] || continue
+    name=${case%.*}
+    input=/dev/null
+    [ -e "$name.in" ] && input=$name.in
+    if [ "${case##*.}" = repl ]; then
+        actual=$(timeout 60 "$program" --repl < "$case" 2>&1)
+    else
+        actual=$(timeout 60 "$program" "$case" < "$input" 2>&1)
+    fi
+    if [ "$actual" != "$(cat "$name.out")" ]; then
+        echo "FAIL $case"
+        diff <(echo "$actual") "$name.out" | head -10
+        failed=$((failed + 1))
+    fi
+done
+echo "$failed failed"
+[ $failed -eq 0 ]
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//арена единицы компиляции: узлы и их массивы выделяются сдвигом указателя и освобождаются разом
+class Arena : public std::pmr::memory_resource {
+public:
+    explicit Arena(std::size_t block_size = 64 * 1024);
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template<class T, class... Args>
+    T* make(Args&&... args) {
+        auto object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            finalizers = new (allocate(sizeof(Finalizer), alignof(Finalizer))) Finalizer{[](void* object) { static_cast<T*>(object)->~T(); }, object, finalizers};
+        }
+        return object;
+    }
+
+    //сколько байт арены занимает один объект вместе с записью о деструкторе
+    template<class T>
+    static constexpr std::size_t footprint() {
+        return sizeof(T) + (std::is_trivially_destructible_v<T> ? 0 : sizeof(Finalizer));
+    }
+
+    void adopt(std::unique_ptr<Arena>);//забирает арену другого потока, её память живёт до конца этой
+
+    std::size_t allocations() const { return count; }
+    std::size_t bytes() const { return used; }
+private:
+    //деструкторы объектов хранятся списком в самой арене и вызываются в обратном порядке
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    void* do_allocate(std::size_t, std::size_t) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    Finalizer* finalizers = nullptr;
+    std::vector<std::unique_ptr<Arena>> adopted;
+    std::byte* cursor = nullptr;
+    std::byte* limit = nullptr;
+    std::size_t block_size;
+    std::size_t count = 0, used = 0;
+};
@@ -2,7 +2,10 @@
 
 #include <string>
 #include <vector>
-#include <memory> 
+#include <memory_resource>
+#include <utility>
+
+#include "symbols.hpp"
 
 class Visitor;
 
@@ -26,19 +29,20 @@ struct Statement : public ASTNode {
 	virtual ~Statement() = default;
 };
 
-using node = std::shared_ptr<ASTNode>;
-using expr = std::shared_ptr<Expression>;
-using statement = std::shared_ptr<Statement>;
+//узлы живут в арене единицы компиляции (arena.hpp), дерево ссылается на них без владения
+using node = ASTNode*;
+using expr = Expression*;
+using statement = Statement*;
 
 /////////////////////////////////////////////////////////////////DECLARATION/////////////////////////////////////////////////////////////////////////
 struct VarDefinition : public Declaration {
 	std::string type;
-	std::string name;
+	symbol name;
 	expr value;
 	bool const_specifier;
 	int initialisedFlag = 0;
 
-	VarDefinition(const std::string& type, const std::string& name, expr value, bool const_specifier = false)
+	VarDefinition(const std::string& type, symbol name, expr value, bool const_specifier = false)
 		: type(type), name(name), value(value) , const_specifier(const_specifier) {}
 
 	VarDefinition(const VarDefinition& root){
@@ -53,18 +57,17 @@ struct VarDefinition : public Declaration {
 
 struct FuncDefinition : public Declaration {
 	std::string returnType;
-	std::string funcName;
-	std::vector<std::shared_ptr<VarDefinition>> argsList;
+	symbol funcName;
+	std::pmr::vector<VarDefinition*> argsList;
 	statement commandsList;
 	int initialisedFlag = 0;
 
-	FuncDefinition(const std::string& returnType, const std::string& funcName, std::vector<std::shared_ptr<VarDefinition>> argsList, const statement& commandsList)
-		: returnType(returnType), funcName(funcName), argsList(argsList), commandsList(commandsList) {}
+	FuncDefinition(const std::string& returnType, symbol funcName, std::pmr::vector<VarDefinition*> argsList, const statement& commandsList)
+		: returnType(returnType), funcName(funcName), argsList(std::move(argsList)), commandsList(commandsList) {}
 
-	FuncDefinition(const FuncDefinition& root){
+	FuncDefinition(const FuncDefinition& root) : argsList(root.argsList, root.argsList.get_allocator()){
 		returnType = root.returnType;
 		funcName = root.funcName;
-		argsList = root.argsList;
 		commandsList = root.commandsList;
 		initialisedFlag = root.initialisedFlag;
 	}
@@ -73,9 +76,9 @@ struct FuncDefinition : public Declaration {
 
 /////////////////////////////////////////////////////////////////STATEMENT/////////////////////////////////////////////////////////////////////
 struct BlockStatement : public Statement {
-	std::vector<statement> instructions;
+	std::pmr::vector<statement> instructions;
 
-	BlockStatement(const std::vector<statement>& instructions) : instructions(instructions) {}
+	BlockStatement(std::pmr::vector<statement> instructions) : instructions(std::move(instructions)) {}
 	void accept(Visitor&);
 };
 
@@ -89,7 +92,7 @@ struct ExprStatement : public Statement {
 struct CondStatement : public Statement {
 	expr condition;
 	statement if_instruction;
-	statement else_instruction;
+	statement else_instruction = nullptr;
 
 	CondStatement(const expr& condition, const statement& if_instruction, const statement& else_instruction) : condition(condition), if_instruction(if_instruction), else_instruction(else_instruction) {}
 	CondStatement(const expr& condition, const statement& if_instruction) : condition(condition), if_instruction(if_instruction) {}
@@ -97,11 +100,11 @@ struct CondStatement : public Statement {
 };
 
 struct ForLoopStatement : public Statement {
-	std::vector<std::shared_ptr<VarDefinition>> preInstructions;
+	std::pmr::vector<VarDefinition*> preInstructions;
 	expr condition, postInstructions;
 	statement instructions;
 
-	ForLoopStatement(const std::vector<std::shared_ptr<VarDefinition>>& preInstructions, const expr& condition, const expr& postInstructions, const statement& instructions)
+	ForLoopStatement(const std::pmr::vector<VarDefinition*>& preInstructions, const expr& condition, const expr& postInstructions, const statement& instructions)
 		: preInstructions(preInstructions), condition(condition), postInstructions(postInstructions), instructions(instructions) {}
 	void accept(Visitor&);
 };
@@ -123,16 +126,16 @@ struct JumpStatement : public Statement {
 };
 
 struct VarDeclStatement : public Statement {
-	std::shared_ptr<VarDefinition> var;
+	VarDefinition* var;
 
-	VarDeclStatement(const std::shared_ptr<VarDefinition>& var) : var(var) {}
+	VarDeclStatement(VarDefinition* var) : var(var) {}
 	void accept(Visitor&);
 };
 
 struct FuncDeclStatement : public Statement {
-	std::shared_ptr<FuncDefinition> func;
+	FuncDefinition* func;
 
-	FuncDeclStatement(const std::shared_ptr<FuncDefinition>& func) : func(func) {}
+	FuncDeclStatement(FuncDefinition* func) : func(func) {}
 	void accept(Visitor&);
 };
 /////////////////////////////////////////////////////////EXPRESSION//////////////////////////////////////////////////////////
@@ -174,11 +177,11 @@ struct UnaryNode : public Expression {
 };
 
 struct FunctionNode : public Expression {
-	std::string name;
-	std::vector<expr> branches;
+	symbol name;
+	std::pmr::vector<expr> branches;
 
-	FunctionNode(const std::string& name, const std::vector<expr>& branches)
-		: name(name), branches(branches) {}
+	FunctionNode(symbol name, std::pmr::vector<expr> branches)
+		: name(name), branches(std::move(branches)) {}
 
 	void accept(Visitor&);
 };
@@ -216,9 +219,9 @@ struct BoolNode : public Expression {
 };
 
 struct IdentifierNode : public Expression{
-	std::string name;
+	symbol name;
 
-	IdentifierNode(const std::string& name)
+	IdentifierNode(symbol name)
 		: name(name) {}
 	void accept(Visitor&);
 };
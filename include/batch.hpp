@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "visitor.hpp"
+
+//столбец значений одного выражения по всем строкам пакета, bool хранится байтом
+using column = std::variant<std::vector<int>, std::vector<double>, std::vector<char>, std::vector<std::uint8_t>>;
+using lanes = std::vector<std::uint8_t>;//маска активных строк
+
+//исполняет одну функцию сразу над блоком строк: арифметика идёт по столбцам, ветвления - по маскам
+class BatchExecutor : public Visitor {
+public:
+    BatchExecutor(const std::vector<statement>&);
+
+    void visit(BinaryNode&);
+    void visit(UnaryNode&);
+    void visit(FunctionNode&);
+    void visit(IdentifierNode&);
+    void visit(IntNode&);
+    void visit(DoubleNode&);
+    void visit(CharNode&);
+    void visit(ParenthesizedNode&);
+    void visit(FuncDefinition&);
+    void visit(VarDefinition&);
+    void visit(ExprStatement&);
+    void visit(CondStatement&);
+    void visit(ForLoopStatement&);
+    void visit(WhileLoopStatement&);
+    void visit(JumpStatement&);
+    void visit(PostfixNode&);
+    void visit(PrefixNode&);
+    void visit(VarDeclStatement&);
+    void visit(FuncDeclStatement&);
+    void visit(BlockStatement&);
+    void visit(BoolNode&);
+
+    //строка входа - значения параметров через пробел, на выходе по результату в строке
+    void run(const std::string&, std::istream&, std::ostream&);
+
+    static constexpr std::size_t block_size = 4096;
+private:
+    struct Loop {
+        lanes broken, continued;
+    };
+
+    struct Frame {
+        std::vector<std::unordered_map<symbol, column>> scopes;
+        std::vector<Loop> loops;
+        lanes returned;
+        column result;
+        bool has_result = false;
+    };
+
+    column call(FuncDefinition&, std::vector<column>&);
+    column* lookup(symbol);
+    column* target(const expr&);
+    void assign(column&, const column&);
+    void settle(const lanes&);
+    void declare(symbol, column);
+
+    std::vector<statement> program;
+    std::unordered_map<symbol, FuncDefinition*> functions;
+    std::unordered_map<symbol, column> globals;
+    std::vector<Frame> frames;
+    lanes mask;
+    column curr;
+    std::size_t width = 0;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+//общий каталог кэша сборок: INTERPRETER_CACHE, иначе XDG_CACHE_HOME/interpreter, иначе ~/.cache/interpreter
+std::filesystem::path cache_directory();
+
+inline constexpr std::uint64_t fnv_offset = 14695981039346656037ull;
+
+std::uint64_t content_hash(std::string_view, std::uint64_t seed = fnv_offset);//FNV-1a
+std::string hex(std::uint64_t);//16 шестнадцатеричных цифр - имя файла в кэше
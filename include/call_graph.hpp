@@ -0,0 +1,49 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "visitor.hpp"
+
+//граф вызовов между объявлениями верхнего уровня; по нему анализ и исполнение
+//получают только функции, достижимые из корней, остальные проходят лишь разбор
+class CallGraph : public Visitor {
+public:
+    //с variables рёбра ведут и к прочитанным или изменённым именам - граф зависимостей объявлений
+    CallGraph(const std::vector<statement>&, bool variables = false);
+
+    void visit(BinaryNode&);
+    void visit(UnaryNode&);
+    void visit(FunctionNode&);
+    void visit(IdentifierNode&);
+    void visit(IntNode&);
+    void visit(DoubleNode&);
+    void visit(CharNode&);
+    void visit(ParenthesizedNode&);
+    void visit(FuncDefinition&);
+    void visit(VarDefinition&);
+    void visit(ExprStatement&);
+    void visit(CondStatement&);
+    void visit(ForLoopStatement&);
+    void visit(WhileLoopStatement&);
+    void visit(JumpStatement&);
+    void visit(PostfixNode&);
+    void visit(PrefixNode&);
+    void visit(VarDeclStatement&);
+    void visit(FuncDeclStatement&);
+    void visit(BlockStatement&);
+    void visit(BoolNode&);
+
+    //объявления в исходном порядке: глобальные переменные и функции, достижимые из них и из roots
+    std::vector<statement> reachable(const std::vector<symbol>& roots) const;
+
+    const std::vector<symbol>& callees(symbol) const;
+    const std::vector<symbol>& initializers() const { return globals; }
+    static std::vector<symbol> references(statement);//имена, которые вызывает или читает объявление, без повторов
+private:
+    std::vector<statement> program;
+    std::unordered_map<symbol, std::vector<symbol>> calls;//функция -> вызываемые ею функции
+    std::vector<symbol> globals;//функции, вызываемые инициализаторами глобальных переменных
+    std::vector<symbol>* current = nullptr;
+    bool variables;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+#include "scope.hpp"
+
+//плоское AST: узлы одного размера лежат подряд, дети - 32-битные индексы, обход - switch по виду узла
+using node_id = std::uint32_t;
+inline constexpr node_id no_node = std::numeric_limits<node_id>::max();
+
+enum class NodeKind : std::uint8_t {
+    BINARY, UNARY, POSTFIX, PREFIX, CALL, IDENTIFIER, INT, DOUBLE, CHAR, BOOL, PARENTHESIZED,
+    VAR_DEF, FUNC_DEF, EXPR, COND, WHILE, JUMP, BLOCK
+};
+
+//операторы и виды переходов вместо строк узлов
+enum class Op : std::uint8_t {
+    NONE, ADD, SUB, MUL, DIV, EQUAL, NOT_EQUAL, GREATER, GREATER_EQUAL, LESS, LESS_EQUAL, OR, AND, XOR,
+    ASSIGN, ADD_ASSIGN, SUB_ASSIGN, MUL_ASSIGN, DIV_ASSIGN,
+    INCREMENT, DECREMENT, MINUS, PLUS, NOT,
+    RETURN, BREAK, CONTINUE, COUNT
+};
+
+//поля a, b, c по видам:
+//BINARY - a, b операнды; UNARY/POSTFIX/PREFIX/PARENTHESIZED/EXPR - a операнд
+//CALL - a имя, c список аргументов; IDENTIFIER - a имя
+//INT/CHAR/BOOL - a значение; DOUBLE - a номер в doubles
+//VAR_DEF - a имя, b значение; FUNC_DEF - a имя, b тело, c список параметров (VAR_DEF)
+//COND - a условие, b if, c else; WHILE - a условие, b тело; JUMP - a выражение; BLOCK - c список
+struct FlatNode {
+    NodeKind kind;
+    Op op = Op::NONE;
+    Type type = Type::VOID;
+    bool constant = false;
+    std::uint32_t a = no_node, b = no_node, c = no_node;
+};
+
+static_assert(sizeof(FlatNode) == 16);
+
+//узлы лежат либо в векторах построителя, либо прямо в отображённом файле кэша
+struct FlatAst {
+    std::span<const FlatNode> nodes;
+    std::span<const double> doubles;
+    std::span<const node_id> lists;//списки детей с длиной в первом элементе
+    std::span<const node_id> roots;
+
+    static FlatAst build(const std::vector<statement>&);
+
+    //файл кэша: заголовок, массивы как в памяти и имена символов по номерам
+    void save(const std::string& path, std::uint64_t key) const;
+    //пусто, если файла нет, он от другого ключа или номера символов в этом процессе уже заняты другими именами
+    static std::optional<FlatAst> load(const std::string& path, std::uint64_t key);
+    static std::uint32_t version();//версия формата и смысла узлов; ключи кэшей зависят от неё
+
+    const FlatNode& operator[](node_id id) const {
+        return nodes[id];
+    }
+
+    std::span<const node_id> list(std::uint32_t offset) const {
+        return lists.subspan(offset + 1, lists[offset]);
+    }
+
+    int integer(node_id id) const {
+        return static_cast<int>(nodes[id].a);
+    }
+
+    double number(node_id id) const {
+        return doubles[nodes[id].a];
+    }
+
+    static std::string_view spelling(Op);
+    static std::string_view spelling(Type);
+private:
+    std::shared_ptr<const void> storage;
+};
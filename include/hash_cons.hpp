@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "arena.hpp"
+#include "ast.hpp"
+
+//хеш-консинг разбора: структурно одинаковые чистые поддеревья (литералы, имена, арифметика без присваиваний)
+//становятся одним общим узлом арены; выключенная таблица просто выделяет каждый узел заново
+class HashCons {
+public:
+    struct Stats {
+        std::size_t unique = 0;//узлов в таблице
+        std::size_t shared = 0;//повторов, вместо которых взят готовый узел
+        std::size_t saved = 0;//байт арены, которые не пришлось выделять
+
+        Stats& operator+=(const Stats&);
+    };
+
+    HashCons(Arena&, bool enabled);
+
+    expr integer(int);
+    expr number(double);
+    expr character(char);
+    expr boolean(bool);
+    expr identifier(symbol);
+    expr unary(std::string_view, expr);
+    expr parenthesized(expr);
+    expr binary(std::string_view, expr, expr, bool pure);//присваивание не чисто и не делится
+
+    const Stats& stats() const { return counters; }
+private:
+    enum class Shape : std::uint8_t { INT, DOUBLE, CHAR, BOOL, IDENTIFIER, UNARY, PARENTHESIZED, BINARY };
+
+    //дети уже канонические, поэтому структурное равенство сводится к равенству указателей
+    struct Key {
+        std::uint64_t payload;
+        const Expression* left;
+        const Expression* right;
+        std::uint16_t op;
+        Shape shape;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key&) const;
+    };
+
+    template<class T, class... Args>
+    expr intern(const Key&, Args&&...);
+    bool pure(expr) const;
+
+    Arena& arena;
+    bool enabled;
+    std::unordered_map<Key, expr, KeyHash> table;
+    std::unordered_set<const Expression*> canonical;
+    Stats counters;
+};
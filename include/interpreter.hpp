@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arena.hpp"
+#include "ast.hpp"
+#include "symbols.hpp"
+
+//встраиваемый интерфейс libinterpreter.a: программа собирается один раз и исполняется сколько угодно раз
+//из любых потоков, у каждого исполнения свой Context
+
+//разобранная и проверенная программа; после compile не меняется, поэтому её можно делить между потоками
+class Program {
+public:
+    static std::shared_ptr<const Program> compile(std::string source);//ошибки разбора и анализа - std::runtime_error
+
+    Program(const Program&) = delete;
+    Program& operator=(const Program&) = delete;
+
+    const std::vector<statement>& declarations() const { return tree; }
+    std::string_view source() const { return text; }
+    Interner& interner() const { return *names; }//имена программы; освобождаются вместе с ней
+private:
+    Program() = default;
+
+    std::unique_ptr<Interner> names = std::make_unique<Interner>();
+    std::string text;//лексер и дерево ссылаются на текст
+    Arena arena;
+    std::vector<statement> tree;
+};
+
+//ввод и вывод исполнения: read заполняет буфер и возвращает число байт, 0 - конец ввода;
+//write получает очередной кусок вывода, print сбрасывает его после каждой строки; пустые - std::cin и std::cout
+struct Io {
+    std::function<std::size_t(char*, std::size_t)> read;
+    std::function<void(std::string_view)> write;
+};
+
+//одно исполнение программы; сам Context не делится между потоками, но их может быть сколько угодно на одну программу
+class Context {
+public:
+    explicit Context(std::shared_ptr<const Program> program, Io io = {});
+
+    void run();//ошибки исполнения - std::runtime_error, вывод до ошибки уже отдан write
+private:
+    std::shared_ptr<const Program> program;
+    Io io;
+};
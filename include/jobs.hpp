@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+//задание пакетного запуска: программа, файл ввода ("-" - пустой ввод) и файл для вывода
+struct Job {
+    std::string program, input, output;
+};
+
+struct JobReport {
+    std::size_t failed = 0, programs = 0, rejected = 0;//programs - собранные программы, rejected - не собравшиеся
+    double compile_seconds = 0, seconds = 0;
+    std::vector<double> latencies;//миллисекунды по заданиям: чтение ввода, исполнение, запись вывода
+
+    void print(std::ostream&) const;
+};
+
+//строки манифеста - "программа ввод вывод"; относительные пути считаются от каталога манифеста
+std::vector<Job> read_manifest(const std::string& path);
+
+//каждая программа собирается один раз, задания исполняются пулом с перехватом работы;
+//ошибки заданий печатаются в errors и не останавливают остальные
+JobReport run_jobs(const std::vector<Job>&, std::ostream& errors, unsigned threads = 0);
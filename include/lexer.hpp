@@ -1,24 +1,43 @@
 #pragma once
 
-#include <vector>
-#include <unordered_set>
+#include <array>
+#include <string_view>
+#include <utility>
 
 #include "token.hpp"
 
 class Lexer {
 public:
-    Lexer(const std::string&);//конструктор копирования
-    std::vector<Token> tokenize();//создание вектора токенов
+    Lexer(std::string_view, std::size_t = 0);//исходник не копируется и должен жить дольше токенов, разбор с указанной позиции
+    TokenStream tokenize();//создание потока токенов целиком
+    //извлекает следующий токен, после конца исходника всегда END
+    Token next() {
+        auto token = peek();
+        head = (head + 1) % lookahead;
+        count--;
+        return token;
+    }
+
+    //токен на k вперёд без извлечения
+    const Token& peek(std::size_t k = 0) {
+        return k < count ? ring[(head + k) % lookahead] : fill(k);
+    }
+
+    std::pair<std::size_t, std::size_t> position(const Token&) const;//строка и столбец токена
+
+    static constexpr std::size_t lookahead = 4;//размер кольца опережающих токенов
 private:
+    Token scan();
+    const Token& fill(std::size_t);
     Token extract_number();
     Token extract_identifier();
     Token extract_operator();
+    char at(std::size_t) const;//символ исходника или '\0' за его концом
+    void skip_blanks();
+    std::size_t word_length(std::size_t) const;
 
-    static const std::string metachars;
-    static const std::unordered_set<std::string> operators;
-    static const std::unordered_set<std::string> keyWords;
-    static const std::unordered_set<std::string> varTypes;
-
-    std::string input;
+    std::string_view input;
     std::size_t offset;
-};
\ No newline at end of file
+    std::array<Token, lookahead> ring;
+    std::size_t head = 0, count = 0;
+};
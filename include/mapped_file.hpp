@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//исходник, отображённый в память только для чтения: лексер читает страницы файла без копирования
+class MappedFile {
+public:
+    explicit MappedFile(const std::string&);
+    ~MappedFile();
+    MappedFile(MappedFile&&) noexcept;
+    MappedFile& operator=(MappedFile&&) = delete;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view text() const { return {data, size}; }
+    const std::string& path() const { return name; }
+private:
+    std::string name;
+    const char* data = nullptr;
+    std::size_t size = 0;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.hpp"
+#include "mapped_file.hpp"
+#include "visitor.hpp"
+
+//модуль - файл объявлений, подключаемый строкой import "путь"; в начале программы или другого модуля.
+//Проверенный модуль описывается интерфейсом: сигнатуры, диапазоны текста и зависимости объявлений
+//и итоги их проверки. Интерфейс хранится в кэше по хешу содержимого и ключей импортов, поэтому модуль
+//проверяется один раз, а программа разбирает из него только объявления, до которых доходит по ссылкам
+struct ModuleDeclaration {
+    std::string name;
+    std::size_t begin = 0, end = 0;//диапазон текста в файле модуля
+    std::string signature;
+    std::vector<std::string> references, reads, assigned;
+};
+
+struct Module {
+    explicit Module(const std::string& path) : source(path) {}
+
+    MappedFile source;
+    std::vector<Module*> imports;
+    std::size_t body = 0;//начало объявлений после импортов
+    std::size_t level = 0;//длина самой длинной цепочки импортов под модулем
+    std::uint64_t key = 0;
+    std::vector<ModuleDeclaration> declarations;
+    bool cached = false;//интерфейс взят из кэша, а не проверен заново
+
+    std::mutex mutex;//объявление разбирается по первому требованию из любого потока
+    std::unique_ptr<Arena> arena = std::make_unique<Arena>();
+    std::vector<statement> parsed;
+};
+
+//импорты в начале файла и позиция первого объявления после них
+struct ModuleHeader {
+    std::vector<std::string> imports;
+    std::size_t body = 0;
+};
+
+ModuleHeader read_header(std::string_view);
+
+class ModuleLoader {
+public:
+    struct Stats {
+        std::size_t modules = 0;
+        std::size_t compiled = 0;//проверено в этом запуске, остальные взяты из кэша
+        std::size_t linked = 0;//объявлений модулей попало в программу
+    };
+
+    explicit ModuleLoader(unsigned threads = 0);
+
+    //открывает импорты файла и всё, что импортируют они; независимые модули проверяются параллельно
+    void load(const std::string& importer, const std::vector<std::string>& imports);
+    //объявления модулей, нужные программе и roots, в порядке импортов; их готовые итоги проверки дописываются в units
+    std::vector<statement> link(const std::vector<statement>& program, std::vector<Analyzer::Unit>& units, const std::vector<symbol>& roots = {});
+
+    bool empty() const { return order.empty(); }
+    const Stats& stats() const { return counters; }
+private:
+    Module* open(const std::string& path, std::vector<std::string>& stack);
+    void compile(Module&);
+    bool read_interface(Module&);
+    void write_interface(const Module&);
+    statement declaration(Module&, std::size_t);
+    std::vector<statement> closure(const std::vector<Module*>&, const std::vector<symbol>&, std::vector<Analyzer::Unit>&);
+
+    unsigned threads;
+    std::unordered_map<std::string, std::unique_ptr<Module>> modules;//по каноническому пути
+    std::vector<Module*> order;//импортируемые раньше импортирующих
+    Stats counters;
+};
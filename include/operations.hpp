@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <type_traits>
+
+//операции языка в виде прозрачных функторов для типизированных бэкендов (трассы, пакетное исполнение)
+//совпадают с таблицами Executor, включая их текущие '>' и '||'
+
+struct Same {
+    template<class T>
+    T operator()(T value) const { return value; }
+};
+
+struct Increment {
+    template<class T>
+    auto operator()(T value) const {
+        if constexpr (std::is_same_v<T, bool>) return value;
+        else return value + 1;
+    }
+};
+
+struct Decrement {
+    template<class T>
+    auto operator()(T value) const {
+        if constexpr (std::is_same_v<T, bool>) return value;
+        else return value - 1;
+    }
+};
+
+struct Assign {
+    template<class L, class R>
+    R operator()(L, R value) const { return value; }
+};
+
+//вызывает f с функтором операции op, false если такой операции нет
+template<class F>
+bool with_binary_operation(const std::string& op, F&& f) {
+    if(op == "+") f(std::plus<>{});
+    else if(op == "-") f(std::minus<>{});
+    else if(op == "*") f(std::multiplies<>{});
+    else if(op == "/") f(std::divides<>{});
+    else if(op == "==") f(std::equal_to<>{});
+    else if(op == "!=") f(std::not_equal_to<>{});
+    else if(op == ">") f(std::logical_or<>{});
+    else if(op == ">=") f(std::greater_equal<>{});
+    else if(op == "<") f(std::less<>{});
+    else if(op == "<=") f(std::less_equal<>{});
+    else if(op == "||") f(std::not_equal_to<>{});
+    else if(op == "&&") f(std::logical_and<>{});
+    else return false;
+    return true;
+}
+
+template<class F>
+bool with_assignment_operation(const std::string& op, F&& f) {
+    if(op == "=") f(Assign{});
+    else if(op == "+=") f(std::plus<>{});
+    else if(op == "-=") f(std::minus<>{});
+    else if(op == "*=") f(std::multiplies<>{});
+    else if(op == "/=") f(std::divides<>{});
+    else return false;
+    return true;
+}
+
+template<class F>
+bool with_unary_operation(const std::string& op, F&& f) {
+    if(op == "++") f(Increment{});
+    else if(op == "--") f(Decrement{});
+    else if(op == "-") f(std::negate<>{});
+    else if(op == "+") f(Same{});
+    else if(op == "!") f(std::logical_not<>{});
+    else return false;
+    return true;
+}
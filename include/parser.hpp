@@ -1,41 +1,51 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
 
-#include "token.hpp"
+#include "arena.hpp"
+#include "lexer.hpp"
 #include "ast.hpp"
+#include "hash_cons.hpp"
 
 class Parser {
 public:
-    Parser(const std::vector<Token>&);
+    Parser(Lexer, Arena&, bool hash_cons = false);//токены вытягиваются из лексера по мере разбора, узлы выделяются в арене
     std::vector<statement> parse();
+    std::vector<statement> parse_statements();//инструкции и объявления вперемешку, как в теле функции; для REPL
+    //делит исходник на куски по границам объявлений верхнего уровня и разбирает их параллельно;
+    //с ненулевым stats одинаковые чистые поддеревья каждого куска делятся, а экономия суммируется туда;
+    //begin - начало объявлений, например после заголовка импортов
+    static std::vector<statement> parse_parallel(std::string_view, Arena&, unsigned threads = 0, HashCons::Stats* stats = nullptr, std::size_t begin = 0);
+    static std::vector<std::size_t> declaration_ends(std::string_view);//позиции сразу за объявлениями верхнего уровня
     void print_tokens();
+    const HashCons::Stats& hash_cons_stats() const { return nodes.stats(); }
 private:
-    std::vector<std::shared_ptr<VarDefinition>> parse_param_list();
+    std::pmr::vector<VarDefinition*> parse_param_list();
     statement parse_decl_statement();
     statement parse_statement();
     statement parse_block_statement();
-    std::shared_ptr<JumpStatement> parse_jump_statement();
-    std::shared_ptr<ForLoopStatement> parse_for_statement();
-    std::shared_ptr<VarDefinition> parse_arg();
-    std::shared_ptr<ExprStatement> parse_expr_statement();
-    std::shared_ptr<FuncDefinition> parse_function_definition();
+    JumpStatement* parse_jump_statement();
+    ForLoopStatement* parse_for_statement();
+    VarDefinition* parse_arg();
+    ExprStatement* parse_expr_statement();
+    FuncDefinition* parse_function_definition();
     expr parse_binary_expression(int);
     expr parse_base_expression();
     expr parse_parenthesized_expression();
     expr parse_var_value();
     expr parse_cond_statement();
     expr parse_identifier_or_digit();
-    std::vector<expr> parse_function_interior();
+    std::pmr::vector<expr> parse_function_interior();
     std::string parse_var_type();
-    std::string parse_identifier();
+    symbol parse_identifier();
 
-    bool match(TokenType) const;//проверяет на соответсвие текущий токен из последовательности с токеном указанным в скобках
+    bool match(TokenType);//проверяет на соответсвие текущий токен из последовательности с токеном указанным в скобках
     std::string extract(TokenType);//возвращает значение текущего токена, если тип указанный в скобках совпал
+    symbol extract_symbol();//номер имени текущего идентификатора
+    template<class T>
+    T extract_number(TokenType);//числовой литерал без промежуточной строки
 
-    static const std::unordered_map<std::string, int> operators;
-
-    std::vector<Token> tokens;
-    std::size_t offset;
+    Lexer lexer;
+    Arena& arena;
+    HashCons nodes;//через неё создаются узлы выражений
 };
\ No newline at end of file
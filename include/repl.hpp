@@ -0,0 +1,25 @@
+#pragma once
+
+#include <deque>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+#include "arena.hpp"
+#include "visitor.hpp"
+
+//интерактивная сессия: каждая запись разбирается, проверяется и исполняется сразу,
+//на общих глобальных областях анализатора и исполнителя; прежние записи не перепроверяются
+class Repl {
+public:
+    Repl(std::istream& input, std::ostream& output);
+
+    bool submit(std::string_view entry, std::ostream& errors);//false и сообщение в errors, если запись отвергнута
+    void run(std::istream& lines, std::ostream& errors, bool prompts);//запись заканчивается на ';' или '}' вне скобок
+private:
+    Interner names;//имена сессии; освобождаются вместе с ней
+    std::deque<std::string> texts;//тексты записей живут всю сессию, как и их деревья
+    Arena arena;
+    Analyzer analyzer;
+    Executor executor;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//пул с перехватом работы: у каждого потока своя дека, свои задачи он берёт с конца,
+//чужие забирает с начала, когда своя пуста
+class Scheduler {
+public:
+    using Task = std::function<void()>;
+
+    explicit Scheduler(unsigned threads = 0);
+    ~Scheduler();//дожидается всех задач
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    static Scheduler& shared();//общий пул процесса на все ядра, создаётся при первом обращении
+
+    void submit(Task);//из потока пула - в его деку, иначе по кругу; задача не должна бросать исключений
+    bool run_one();//выполнить одну ожидающую задачу в текущем потоке; false, если ждать нечего
+    void wait();//ждёт, пока выполнятся все отправленные задачи, и помогает их выполнять; не из задачи
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool take(std::size_t self, Task&);
+    void loop(std::size_t self);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::jthread> threads;
+    std::atomic<std::size_t> queued = 0;//задачи в деках
+    std::atomic<std::size_t> pending = 0;//отправленные и ещё не завершённые
+    std::atomic<std::size_t> next = 0;
+    std::mutex idle_mutex;
+    std::condition_variable idle;//спящие потоки пула и wait
+    bool stopping = false;
+};
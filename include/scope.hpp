@@ -5,10 +5,11 @@
 #include <memory>
 #include <stack>
 #include <variant>
+#include <limits>
 
 #include "ast.hpp"
 
-enum class Type{
+enum class Type : std::uint8_t {
     VOID, INT, DOUBLE, CHAR, BOOL
 };
 
@@ -29,34 +30,34 @@ struct Variable : public Symbol {
 
 struct Function : public Symbol {
     Type returnType;
-    std::vector<std::pair<std::string, std::shared_ptr<Variable>>> arguments;
-    std::shared_ptr<BlockStatement> body;
+    std::vector<std::pair<symbol, std::shared_ptr<Variable>>> arguments;
+    BlockStatement* body;
+    std::uint32_t node = std::numeric_limits<std::uint32_t>::max();//тело в плоском AST
     
-    Function(Type& returnType, std::vector<std::pair<std::string, std::shared_ptr<Variable>>>& arguments, std::shared_ptr<BlockStatement>& body)
+    Function(Type& returnType, std::vector<std::pair<symbol, std::shared_ptr<Variable>>>& arguments, BlockStatement* body)
     	: returnType(returnType), arguments(arguments), body(body) {}
 };
 
-using DeclarationTable = std::unordered_map<std::string, std::shared_ptr<Declaration>>;
-using SymbolTable = std::unordered_map<std::string, std::shared_ptr<Symbol>>;
+using SymbolTable = std::unordered_map<symbol, std::shared_ptr<Symbol>>;
 
 class Scope {
 public:
     Scope(const std::shared_ptr<Scope> parent = nullptr) : parent(parent) {}
 
-    void executorAdd(const std::string& name, std::shared_ptr<Symbol> symbol) {
+    void executorAdd(symbol name, std::shared_ptr<Symbol> symbol) {
         if(executeTable.contains(name)) {
-            throw std::runtime_error("Redeclaration of symbol " + name + ".");
+            throw std::runtime_error("Redeclaration of symbol " + spelling(name) + ".");
         }
         executeTable[name] = symbol;
     }
 
-    void delete_symbol(const std::string& name){
+    void delete_symbol(symbol name){
     	if(executeTable.contains(name)){
     		executeTable.erase(name);
     	}
     }
 
-    std::shared_ptr<Symbol> get_symbol(const std::string& name){
+    std::shared_ptr<Symbol> get_symbol(symbol name){
     	if(!executeTable.contains(name)){
             if(parent == nullptr){
                 return nullptr;
@@ -66,17 +67,30 @@ public:
     	return executeTable[name];
     }
 
-    bool executeLookup(const std::string& name){
+    bool executeLookup(symbol name){
         if(!executeTable.contains(name)){
             if(parent == nullptr){
                 return false;
             }
-            return parent->lookup(name);
+            return parent->executeLookup(name);
         }
         return true;
     }
 	
-    std::shared_ptr<operand> get_value(const std::string& name){
+    //копия для задачи: у переменных свои значения, функции общие
+    std::shared_ptr<Scope> copy() const {
+        auto result = std::make_shared<Scope>(parent);
+        for(auto& [name, symbol] : executeTable){
+            if(auto var = std::dynamic_pointer_cast<Variable>(symbol); var && var->value){
+                result->executeTable[name] = std::make_shared<Variable>(var->type, std::make_shared<operand>(*var->value));
+            }else{
+                result->executeTable[name] = symbol;
+            }
+        }
+        return result;
+    }
+
+    std::shared_ptr<operand> get_value(symbol name){
     	if(!executeTable.contains(name)){
             if(parent == nullptr){
                 return nullptr;
@@ -89,123 +103,157 @@ public:
         return nullptr;
     }
 
+private:
+    SymbolTable executeTable;
+    std::shared_ptr<Scope> parent;
+};
+
+struct ScopeManager {
+    std::stack<std::shared_ptr<Scope>> scopes;
+
+    ScopeManager() {
+        scopes.push(std::make_shared<Scope>());
+    }
 
-    void add(const std::string& name, std::shared_ptr<Declaration> symbol) {
-        if(table.contains(name)) {
-            throw std::runtime_error("Redeclaration of symbol " + name + ".");
+    void enterScope() {
+        if(!scopes.empty()){
+            scopes.push(std::make_shared<Scope>(scopes.top()));
+        }else{
+            scopes.push(std::make_shared<Scope>());
         }
-        table[name] = symbol;
     }
 
-    bool lookup(const std::string& name) {
-        if (!table.contains(name)) {
-            if (parent == nullptr) {
-                return false;
-            }
-            return parent->lookup(name);
+    void exitScope(){
+        scopes.pop();
+    }
+};
+
+//привязка имени в таблице анализатора, тип объявления вычислен один раз
+struct Binding {
+    Declaration* decl;
+    Type type;
+    std::uint32_t depth;
+    std::uint32_t order;//номер объявления верхнего уровня в общей таблице, local - для прочих
+
+    static constexpr std::uint32_t local = std::numeric_limits<std::uint32_t>::max();
+};
+
+//таблица областей анализатора: по номеру имени - стек его привязок, самая внутренняя сверху;
+//выход из области снимает привязки по журналу, поиск не ходит по цепочке родителей
+class SymbolStack {
+public:
+    void enterScope() {
+        marks.push_back(log.size());
+    }
+
+    void exitScope() {
+        for(auto mark = marks.back(); log.size() > mark; log.pop_back()){
+            bindings[log.back()].pop_back();
         }
-        return true;
+        marks.pop_back();
     }
 
-    std::shared_ptr<Declaration> get_element(std::string name){
-        if(lookup(name)){
-            if(!table.contains(name)){
-                return parent->get_element(name);
-            }else{
-                return table[name];
-            }
-        }else{
-            return nullptr;
+    //общая таблица верхнего уровня под этой: из неё видны объявления с номером меньше visible;
+    //её привязки только читаются, так что одну таблицу могут разделять несколько потоков
+    void share(SymbolStack* globals, std::uint32_t visible) {
+        outer = globals;
+        limit = visible;
+    }
+
+    bool shared(const Binding& binding) const {
+        return outer != nullptr && binding.order != Binding::local;
+    }
+
+    //снимает все привязки, например после исключения посреди области
+    void reset() {
+        while(!marks.empty()){
+            exitScope();
+        }
+        for(; !log.empty(); log.pop_back()){
+            bindings[log.back()].pop_back();
         }
     }
 
-    Type search_type(std::string name){
-        if(name == "print" || name == "scan"){
-            return Type::VOID;
+    struct Checkpoint {
+        std::size_t log, marks;
+    };
+
+    Checkpoint checkpoint() const {
+        return {log.size(), marks.size()};
+    }
+
+    //возврат к checkpoint: закрывает открытые после него области и снимает добавленные привязки
+    void rollback(Checkpoint point) {
+        while(marks.size() > point.marks){
+            exitScope();
         }
-        if(lookup(name)){
-            if(!table.contains(name)){
-                return parent->search_type(name);
-            }else{
-                if(auto varDef = dynamic_cast<VarDefinition*>(table[name].get())){
-                    if(varDef->type == "int"){
-                        return Type::INT;
-                    }else if(varDef->type == "double"){
-                        return Type::DOUBLE;
-                    }else if(varDef->type == "char"){
-                        return Type::CHAR;
-                    }else if(varDef->type == "bool"){
-                        return Type::BOOL;
-                    }else if(varDef->type == "void"){
-                        return Type::VOID;
-                    }
-                }else if(auto funcDef = dynamic_cast<FuncDefinition*>(table[name].get())){    
-                    if(funcDef->returnType == "int"){
-                        return Type::INT;
-                    }else if(funcDef->returnType == "double"){
-                        return Type::DOUBLE;
-                    }else if(funcDef->returnType == "char"){
-                        return Type::CHAR;
-                    }else if(varDef->type == "bool"){
-                        return Type::BOOL;
-                    }else if(varDef->type == "void"){
-                        return Type::VOID;
-                    }
-                }
-            }
-        }else{
-            throw std::runtime_error("Undefined symbol " + name);
+        for(; log.size() > point.log; log.pop_back()){
+            bindings[log.back()].pop_back();
         }
-        return Type::VOID;
     }
 
-    bool cheak_init(std::string name){
-        if(lookup(name)){
-            if(!table.contains(name)){
-                return parent->cheak_init(name);
-            }else{
-                if(auto varDef = dynamic_cast<VarDefinition*>(table[name].get())){
-                    if(varDef->initialisedFlag){
-                        return true;
-                    }else{
-                        return false;
-                    }
-                }else if(auto funcDef = dynamic_cast<FuncDefinition*>(table[name].get())){
-                    if(funcDef->initialisedFlag){
-                        return true;
-                    }else{
-                        return false;
-                    }
-                }
+    void add(symbol name, Declaration* decl, Type type, std::uint32_t order = Binding::local) {
+        if(name >= bindings.size()){
+            bindings.resize(name + 1);
+        }
+        auto& stack = bindings[name];
+        auto depth = static_cast<std::uint32_t>(marks.size());
+        if(!stack.empty() && stack.back().depth == depth){
+            throw std::runtime_error("Redeclaration of symbol " + spelling(name) + ".");
+        }
+        stack.push_back({decl, type, depth, order});
+        log.push_back(name);
+    }
+
+    Binding* find(symbol name) {
+        if(name >= bindings.size() || bindings[name].empty()){
+            if(outer != nullptr){
+                auto binding = outer->find(name);
+                return binding != nullptr && binding->order < limit ? binding : nullptr;
             }
-        }else{
-            throw std::runtime_error("Undefined symbol " + name);
+            return nullptr;
         }
-        return false;
+        return &bindings[name].back();
     }
 
-private:
-    DeclarationTable table;
-    SymbolTable executeTable;
-    std::shared_ptr<Scope> parent;
-};
+    Declaration* get_element(symbol name) {
+        auto binding = find(name);
+        return binding == nullptr ? nullptr : binding->decl;
+    }
 
-struct ScopeManager {
-    std::stack<std::shared_ptr<Scope>> scopes;
+    Type search_type(symbol name) {
+        if(name == symbols::print || name == symbols::scan){
+            return Type::VOID;
+        }
+        return resolve(name).type;
+    }
 
-    ScopeManager() {
-        scopes.push(std::make_shared<Scope>());
+    bool cheak_init(symbol name) {
+        return initialised(resolve(name));
     }
 
-    void enterScope() {
-        if(!scopes.empty()){
-            scopes.push(std::make_shared<Scope>(scopes.top()));
-        }else{
-            scopes.push(std::make_shared<Scope>());
+    //привязка видимого имени; одна выборка вместо отдельных поисков типа, объявления и флага
+    Binding& resolve(symbol name) {
+        auto binding = find(name);
+        if(binding == nullptr){
+            throw std::runtime_error("Undefined symbol " + spelling(name));
         }
+        return *binding;
     }
 
-    void exitScope(){
-        scopes.pop();
+    static bool initialised(const Binding& binding) {
+        if(auto varDef = dynamic_cast<VarDefinition*>(binding.decl)){
+            return varDef->initialisedFlag;
+        }
+        if(auto funcDef = dynamic_cast<FuncDefinition*>(binding.decl)){
+            return funcDef->initialisedFlag;
+        }
+        return false;
     }
-};
\ No newline at end of file
+private:
+    std::vector<std::vector<Binding>> bindings;//номера имён плотные, поэтому вместо хеша - индекс
+    std::vector<symbol> log;//объявления открытых областей по порядку
+    std::vector<std::size_t> marks;//начало журнала каждой области
+    SymbolStack* outer = nullptr;
+    std::uint32_t limit = 0;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "interpreter.hpp"
+
+//протокол: запрос - "source <n>\n" и n байт текста либо "program <id>\n" для уже известной программы,
+//затем "input <n>\n" и n байт ввода; ответ - "program <id>\n", кадры вывода "out <n>\n" с n байтами
+//и в конце "done\n" или "error <n>\n" с сообщением. Каждое исполнение идёт в отдельном процессе,
+//поэтому упавшая программа не роняет сервер; процесс убивается, если клиент отключился или программа
+//потратила больше cpu_seconds процессорного времени; разобранные программы хранятся не больше capacity
+class Server {
+public:
+    explicit Server(const std::string& path, unsigned threads = 0, std::size_t capacity = 256, unsigned cpu_seconds = 10);
+    ~Server();
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    void serve();//не возвращается: каждый поток пула сам принимает соединения
+private:
+    std::shared_ptr<const Program> compile(std::string source, std::uint64_t& id);
+    std::shared_ptr<const Program> find(std::uint64_t id);
+    void handle(int client);
+    void run(int client, std::shared_ptr<const Program>, std::string_view input);
+
+    struct Entry {
+        std::shared_ptr<const Program> program;
+        std::list<std::uint64_t>::iterator position;
+    };
+
+    std::string path;
+    int listener = -1;
+    unsigned threads;
+    std::size_t capacity;
+    unsigned cpu_seconds;
+    std::shared_mutex forking;//fork ждёт, пока никто не держит блокировку таблицы имён при разборе
+    std::mutex mutex;
+    std::list<std::uint64_t> recent;//от недавно использованных к давним
+    std::unordered_map<std::uint64_t, Entry> programs;
+};
+
+//клиент: отправляет программу и весь ввод, печатает вывод по мере прихода; ошибку исполнения бросает
+void request(const std::string& path, std::string_view source, std::istream& input, std::ostream& output);
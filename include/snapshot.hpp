@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "scope.hpp"
+
+//глобальные переменные программы на входе в main: восстановленный снимок заменяет вычисление инициализаторов
+struct Snapshot {
+    struct Global {
+        symbol name;
+        Type type;
+        operand value;
+    };
+
+    std::vector<Global> globals;//в порядке объявления
+    std::string output;//что напечатала инициализация, печатается заново при восстановлении
+
+    //текстовый файл: заголовок с ключом, вывод, по строке на переменную; double - в шестнадцатеричной записи без потерь
+    void save(const std::string& path, std::uint64_t key) const;
+    //пусто, если файла нет, он от другого ключа или повреждён
+    static std::optional<Snapshot> load(const std::string& path, std::uint64_t key);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using symbol = std::uint32_t;
+
+//таблица имён: каждый идентификатор получает плотный 32-битный номер. Имена не освобождаются, пока жива таблица,
+//поэтому долгоживущие процессы заводят свою таблицу на программу или сессию и делают её текущей через Use.
+//Номера уникальны в пределах таблицы, но при параллельном разборе их порядок зависит от потоков:
+//всё, что сохраняется на диск, хранит имена, а не только номера
+class Interner {
+public:
+    Interner();
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+
+    static Interner& current();//таблица, текущая в этом потоке; по умолчанию общая для процесса
+
+    //делает таблицу текущей в этом потоке до конца области; разбор, анализ и задачи передают её своим потокам
+    class Use {
+    public:
+        explicit Use(Interner& interner) : previous(active) { active = &interner; }
+        ~Use() { active = previous; }
+        Use(const Use&) = delete;
+        Use& operator=(const Use&) = delete;
+    private:
+        Interner* previous;
+    };
+
+    symbol intern(std::string_view);
+    const std::string& name(symbol);//ссылка стабильна всё время жизни таблицы
+    std::size_t size();
+private:
+    static inline thread_local Interner* active = nullptr;
+
+    std::shared_mutex mutex;//поиск уже известных имён идёт под разделяемой блокировкой
+    std::unordered_map<std::string_view, symbol> ids;
+    std::deque<std::string> names;
+};
+
+//номера встроенных имён фиксированы, сравнение с ними - сравнение целых
+namespace symbols {
+    inline constexpr symbol print = 0;
+    inline constexpr symbol scan = 1;
+    inline constexpr symbol main = 2;
+    inline constexpr symbol spawn = 3;
+    inline constexpr symbol join = 4;
+}
+
+inline const std::string& spelling(symbol id) {
+    return Interner::current().name(id);
+}
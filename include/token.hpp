@@ -1,20 +1,65 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
-enum class TokenType {
+#include "symbols.hpp"
+
+enum class TokenType : std::uint8_t {
 	KEYWORD, VARTYPE, IDENTIFIER, CONST, INT_LITERAL, DOUBLE_LITERAL, CHAR_LITERAL, BOOL_LITERAL, OPERATOR, LPAREN, RPAREN, LBRACE, RBRACE, COMMA, SEMICOLON, END
 };
 
+//представление токена поверх исходника, ничего не владеет
 struct Token {
 	TokenType type;
-	std::string value;
+	std::string_view value;
+	symbol id = 0;//номер имени для идентификаторов
 
 	bool operator==(TokenType other_type) const {
 		return type == other_type;
 	}
 
-	bool operator==(const std::string& other_value) const {
+	bool operator==(std::string_view other_value) const {
 		return value == other_value;
 	}
-};
\ No newline at end of file
+};
+
+//токены в виде структуры массивов: тип байтом, смещение и длина в исходнике, номер имени для идентификаторов
+struct TokenStream {
+	std::string_view source;
+	std::vector<std::uint8_t> kinds;
+	std::vector<std::uint32_t> offsets;
+	std::vector<std::uint32_t> lengths;
+	std::vector<symbol> symbols;
+
+	void push(TokenType type, std::size_t offset, std::size_t length, symbol id = 0) {
+		kinds.push_back(static_cast<std::uint8_t>(type));
+		offsets.push_back(static_cast<std::uint32_t>(offset));
+		lengths.push_back(static_cast<std::uint32_t>(length));
+		symbols.push_back(id);
+	}
+
+	std::size_t size() const {
+		return kinds.size();
+	}
+
+	TokenType type(std::size_t i) const {
+		return static_cast<TokenType>(kinds[i]);
+	}
+
+	std::string_view value(std::size_t i) const {
+		return source.substr(offsets[i], lengths[i]);
+	}
+
+	Token operator[](std::size_t i) const {
+		return Token{type(i), value(i)};
+	}
+
+	//строка и столбец (с единицы), таблица начал строк строится при первом запросе
+	std::pair<std::size_t, std::size_t> position(std::size_t i) const;
+private:
+	mutable std::vector<std::uint32_t> lines;
+};
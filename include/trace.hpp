@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "visitor.hpp"
+
+//значение слота трассы, тип слота известен статически после записи
+union TraceValue {
+    int i;
+    double d;
+    char c;
+    bool b;
+};
+
+struct TraceFrame {
+    std::vector<TraceValue> slots;
+    std::vector<operand> output;//вывод print, откладывается до конца итерации
+};
+
+struct TraceInstr {
+    using handler = bool (*)(TraceFrame&, const TraceInstr&);//false - guard не прошёл
+
+    handler op;
+    std::uint16_t dst, lhs, rhs;
+};
+
+//линейная трасса одной итерации горячего while, записанная с guard'ами
+class Trace {
+public:
+    enum class Exit { LOOP, SIDE };
+
+    Trace(WhileLoopStatement&, const std::function<void(operand&)>&);
+
+    bool hot();//считает обратные переходы цикла
+    Exit enter(const std::shared_ptr<Scope>&);
+
+    static constexpr int hot_threshold = 64;
+private:
+    friend class TraceRecorder;
+
+    enum class State { COLD, RECORDED, BLACKLISTED };
+
+    struct Input {
+        symbol name;
+        std::uint16_t slot;
+        Type type;
+    };
+
+    bool record(const std::shared_ptr<Scope>&);
+    bool bind(const std::shared_ptr<Scope>&);
+    Exit run();
+    void flush();
+    void write_back();
+
+    WhileLoopStatement& loop;
+    std::function<void(operand&)> print;
+    std::vector<TraceInstr> instructions;
+    std::vector<Input> inputs;
+    std::vector<std::pair<std::uint16_t, TraceValue>> constants;
+    std::vector<std::shared_ptr<operand>> bound;
+    std::vector<TraceValue> snapshot;
+    TraceFrame frame;
+    std::size_t header_guard = 0;
+    int back_edges = 0;
+    State state = State::COLD;
+};
+
+class TraceRecorder : public Visitor {
+public:
+    TraceRecorder(Trace&, const std::shared_ptr<Scope>&);
+
+    void visit(BinaryNode&);
+    void visit(UnaryNode&);
+    void visit(FunctionNode&);
+    void visit(IdentifierNode&);
+    void visit(IntNode&);
+    void visit(DoubleNode&);
+    void visit(CharNode&);
+    void visit(ParenthesizedNode&);
+    void visit(FuncDefinition&);
+    void visit(VarDefinition&);
+    void visit(ExprStatement&);
+    void visit(CondStatement&);
+    void visit(ForLoopStatement&);
+    void visit(WhileLoopStatement&);
+    void visit(JumpStatement&);
+    void visit(PostfixNode&);
+    void visit(PrefixNode&);
+    void visit(VarDeclStatement&);
+    void visit(FuncDeclStatement&);
+    void visit(BlockStatement&);
+    void visit(BoolNode&);
+
+    void record();
+private:
+    std::uint16_t slot(Type, bool named = false);
+    std::uint16_t constant(TraceValue, Type);
+    std::uint16_t copy(std::uint16_t);
+    void emit(TraceInstr::handler, std::uint16_t, std::uint16_t = 0, std::uint16_t = 0);
+    void step(const std::string&);
+
+    Trace& trace;
+    std::shared_ptr<Scope> scope;
+    std::vector<Type> types;
+    std::vector<bool> named;
+    std::vector<std::unordered_map<symbol, std::uint16_t>> locals;
+    std::unordered_map<symbol, std::uint16_t> inputs;
+    std::uint16_t curr = 0;//аналог Executor::currRes
+    int var = -1;//аналог Executor::var
+};
@@ -1,9 +1,19 @@
+#pragma once
+
+#include "arena.hpp"
 #include "ast.hpp"
+#include "flat_ast.hpp"
 #include "scope.hpp"
+#include "snapshot.hpp"
 #include <unordered_map>
 #include <functional>
 #include <unordered_set>
 #include <variant>
+#include <sstream>
+#include <iostream>
+#include <exception>
+
+class Trace;
 
 class Visitor {
 public:
@@ -55,6 +65,48 @@ public:
     void visit(BoolNode&);
 
     void print(const std::vector<statement>&);
+    void print(const FlatAst&);
+private:
+    void print(const FlatAst&, node_id);
+};
+
+class Transpiler : public Visitor {
+public:
+    void visit(BinaryNode&);
+    void visit(UnaryNode&);
+    void visit(FunctionNode&);
+    void visit(IdentifierNode&);
+    void visit(IntNode&);
+    void visit(DoubleNode&);
+    void visit(CharNode&);
+    void visit(ParenthesizedNode&);
+    void visit(FuncDefinition&);
+    void visit(VarDefinition&);
+    void visit(ExprStatement&);
+    void visit(CondStatement&);
+    void visit(ForLoopStatement&);
+    void visit(WhileLoopStatement&);
+    void visit(JumpStatement&);
+    void visit(BlockStatement&);
+    void visit(VarDeclStatement&);
+    void visit(FuncDeclStatement&);
+    void visit(PostfixNode&);
+    void visit(PrefixNode&);
+    void visit(BoolNode&);
+
+    std::string transpile(const std::vector<statement>&);//единица трансляции C++ для проанализированного AST
+    static std::string build(const std::string&);//компилирует $CXX (g++) -O2, возвращает путь к бинарнику из кэша
+private:
+    void signature(FuncDefinition&);
+    void body(const statement&);
+    void indent();
+
+    static const std::unordered_map<std::string, std::string> operators;
+    static const std::string runtime;
+
+    std::ostringstream out;
+    int depth = 0;
+    bool global = true;
 };
 
 class Analyzer : public Visitor {
@@ -82,21 +134,62 @@ public:
     void visit(BlockStatement&);
     void visit(BoolNode&);
     
+    //итог проверки одного объявления верхнего уровня в отдельном потоке
+    struct Unit {
+        std::vector<symbol> reads;//глобальные имена, прочитанные до присваивания в этом теле
+        std::vector<symbol> assigned;//глобальные имена, которым тело присваивает
+        std::exception_ptr error;
+        bool checked = false;//итог готов и может быть взят без повторной проверки
+    };
+
     void analyze(const std::vector<statement>&);
+    //сначала по порядку регистрирует объявления верхнего уровня, затем проверяет их тела параллельно;
+    //ошибка та же, что дал бы последовательный analyze. В units - итоги по объявлениям:
+    //отмеченные checked не перепроверяются, остальные заполняются
+    void analyze_parallel(const std::vector<statement>&, unsigned threads = 0, std::vector<Unit>* units = nullptr);
+    //сессия REPL: глобальная область остаётся открытой, записи проверяются как тело main
+    void open_session();
+    void analyze_entry(const std::vector<statement>&);
+    SymbolStack::Checkpoint checkpoint() const { return names.checkpoint(); }
+    void rollback(SymbolStack::Checkpoint);//снимает объявления записей после checkpoint, например не исполнившейся
+    //проверяет библиотеку объявлений без main; итоги по объявлениям остаются в units
+    void analyze_library(const std::vector<statement>&, std::vector<Unit>&, unsigned threads = 0);
+    void analyze(const FlatAst&);
     Type get_type(const std::string&);
+    //то, что проверка зависимого объявления знает об имени: тип, const, наличие значения, типы параметров
+    static std::string signature(statement);
+    static std::uint32_t version();//меняется, когда меняется то, что проверка принимает; ключи кэшей интерфейсов зависят от неё
     static const std::unordered_set<std::string> assignment_operations;
 private:
-    ScopeManager scope_control;
+
+    void check_value(VarDefinition&);
+    void check_body(FuncDefinition&);
+    void check_unit(statement, Unit&);
+    void check_declarations(const std::vector<statement>&, unsigned, std::vector<Unit>*);
+    void check(const FlatAst&, node_id);
+    void check_function(const FlatAst&, node_id);
+    void check_spawn(FunctionNode&);
+    void check_join(FunctionNode&);
+
+    Arena arena;//копии объявлений для таблиц областей видимости
+    SymbolStack names;
     Type currType = Type::VOID;
     std::stack<int> loopFlag;
     bool anotherFunc = false;
     int mainFlag = 0;
     int equalsFlag = 0;
     int lhsFlag = 0;
+    bool spawnFlag = false;//spawn разрешён только как инициализатор переменной int
+    Type spawned = Type::VOID;//тип результата последней проверенной задачи
+    std::unordered_map<Declaration*, Type> tasks;//дескрипторы задач и типы их результатов
+    Unit* unit = nullptr;//флаги общих объявлений не трогаются, вместо этого пишутся сюда
 };
 
 class Executor : public Visitor{
 public:
+    //print и scan работают с потоками исполнителя, чтобы разные запуски не делили консоль
+    explicit Executor(std::istream& input = std::cin, std::ostream& output = std::cout);
+    ~Executor();//дожидается порождённых задач
 
     void visit(BinaryNode&);
     void visit(UnaryNode&);
@@ -123,21 +216,54 @@ public:
     using variable = std::variant<int, double, char, bool>;
 
     void execute(const std::vector<statement>&);
-    variable default_value(Type);
-	Type get_type(std::string);
-	std::vector<std::pair<std::string, std::shared_ptr<Variable>>> get_arguments(std::vector<std::shared_ptr<VarDefinition>>);
+    void execute(const FlatAst&);//без трасс: они записываются по узлам дерева указателей
+
+    //исполнение по частям ради снимков: объявления до main, затем остальное;
+    //initialize и restore возвращают номер объявления main, с него продолжает finish;
+    //restore ничего не делает и возвращает пусто, если глобальные снимка не совпадают с объявленными до main по имени и типу
+    std::size_t initialize(const std::vector<statement>&);
+    std::size_t initialize(const FlatAst&);
+    std::optional<std::size_t> restore(const std::vector<statement>&, const Snapshot&);
+    std::optional<std::size_t> restore(const FlatAst&, const Snapshot&);
+    void finish(const std::vector<statement>&, std::size_t);
+    void finish(const FlatAst&, std::size_t);
+    Snapshot capture();//глобальные переменные после initialize
+    //сессия REPL: глобальная область остаётся открытой; после ошибки записи её объявления сняты, вложенные области закрыты
+    void open_session();
+    void execute_entry(const std::vector<statement>&);
+    bool reads_input() const { return read_input; }//снимок с прочитанным вводом годится только для этого ввода
+    static variable default_value(Type);
+	static Type get_type(std::string);
+	std::vector<std::pair<symbol, std::shared_ptr<Variable>>> get_arguments(const std::pmr::vector<VarDefinition*>&);
 
 private:
+	struct Tasks;//итоги задач, общие для корневого исполнителя и всех порождённых; сами задачи идут в общий пул процесса
+	void spawn(FunctionNode&);
+	void join(FunctionNode&);
+	std::exception_ptr unjoined_error();
+	std::shared_ptr<Trace> hot_trace(WhileLoopStatement&);
+	void adopt(const Snapshot&);
+	void run(const FlatAst&, node_id);
+	void call(const FlatAst&, const FlatNode&);
+
     ScopeManager scope_control;
+	std::unordered_map<WhileLoopStatement*, std::shared_ptr<Trace>> traces;
 	variable currRes;
 	std::shared_ptr<variable> var;
 	bool return_flag = false;
 	bool continue_flag = false;
 	bool break_flag = false;
+	bool read_input = false;
+	std::istream& input;
+	std::ostream& output;
+	std::vector<symbol> globals;//глобальные переменные, объявленные до main
+	std::shared_ptr<Scope> global;//область глобальных: задача получает её копию
+	std::shared_ptr<Tasks> tasks;//свои или корневого исполнителя; задача держит их до своего конца
+	bool owns_tasks = false;//созданы первым spawn этого исполнителя, он и ждёт задачи
 
     static const std::unordered_set<std::string> assignment_operators;
 	static const std::unordered_map<std::string, std::function<variable(variable, variable)>> assignment_operations;
     static const std::unordered_map<std::string, std::function<variable(variable)>> unary_operations;
     static const std::unordered_map<std::string, std::function<variable(variable, variable)>> binary_operations;
-    static const std::unordered_map<std::string, std::function<void(variable&)>> builtin_funcs;
+    static const std::unordered_map<symbol, std::function<void(Executor&, variable&)>> builtin_funcs;
 };
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.hpp"
+#include "visitor.hpp"
+
+//инкрементальная сборка одного исходника: он режется на объявления верхнего уровня,
+//заново лексируются и разбираются только объявления с изменённым текстом, а заново проверяются
+//только те, у которых изменился текст или сигнатура либо видимость имён, на которые они ссылаются
+class Workspace {
+public:
+    struct Stats {
+        std::size_t declarations = 0;
+        std::size_t parsed = 0;//разобрано заново
+        std::size_t checked = 0;//проверено анализатором заново
+    };
+
+    explicit Workspace(unsigned threads = 0);
+
+    //разобранная и проверенная программа; ошибки разбора и анализа бросаются как в обычной сборке
+    const std::vector<statement>& update(std::string_view);
+    const Stats& stats() const { return counters; }
+private:
+    struct Entry {
+        std::vector<statement> decls;
+        std::shared_ptr<Arena> arena;//арена поколения, в котором объявление было разобрано
+        std::vector<std::vector<symbol>> references;//по объявлению: имена, от которых зависит его проверка
+        std::vector<std::string> environments;//сигнатуры этих имён при последней проверке
+        std::vector<Analyzer::Unit> units;
+        bool live = false;
+    };
+
+    unsigned threads;
+    std::unordered_map<std::string, Entry> entries;//по тексту объявления без крайних пробелов
+    std::vector<statement> program;
+    Stats counters;
+};
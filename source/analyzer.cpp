@@ -1,7 +1,128 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <utility>
+
 #include "visitor.hpp"
 
+namespace {
+
+//2: аргументы print и scan проверяются как обычные выражения
+constexpr std::uint32_t analyzer_version = 2;
+
+//ищет в функции задачи и во всех вызываемых ею функциях запись в нелокальное имя
+class GlobalWrites : public Visitor {
+public:
+    explicit GlobalWrites(SymbolStack& names) : names(names) {}
+
+    std::optional<symbol> find(FuncDefinition& func) {
+        follow(func);
+        return found;
+    }
+
+    void visit(BinaryNode& root) {
+        if(Analyzer::assignment_operations.contains(root.op)){
+            write(root.left_branch);
+        }
+        root.left_branch->accept(*this);
+        root.right_branch->accept(*this);
+    }
+    void visit(UnaryNode& root) { root.branch->accept(*this); }
+    void visit(PostfixNode& root) { write(root.branch); }
+    void visit(PrefixNode& root) { write(root.branch); }
+    void visit(FunctionNode& root) {
+        for(auto arg : root.branches){
+            if(root.name == symbols::scan){
+                write(arg);
+            }
+            arg->accept(*this);
+        }
+        if(auto func = dynamic_cast<FuncDefinition*>(names.get_element(root.name))){
+            follow(*func);
+        }
+    }
+    void visit(IdentifierNode&) {}
+    void visit(IntNode&) {}
+    void visit(DoubleNode&) {}
+    void visit(CharNode&) {}
+    void visit(BoolNode&) {}
+    void visit(ParenthesizedNode& root) { root.expression->accept(*this); }
+    void visit(FuncDefinition&) {}
+    void visit(VarDefinition& root) {
+        if(root.value != nullptr){
+            root.value->accept(*this);
+        }
+        locals.back().insert(root.name);
+    }
+    void visit(ExprStatement& root) { root.expression->accept(*this); }
+    void visit(CondStatement& root) {
+        root.condition->accept(*this);
+        root.if_instruction->accept(*this);
+        if(root.else_instruction != nullptr){
+            root.else_instruction->accept(*this);
+        }
+    }
+    void visit(ForLoopStatement&) {}
+    void visit(WhileLoopStatement& root) {
+        root.condition->accept(*this);
+        root.instructions->accept(*this);
+    }
+    void visit(JumpStatement& root) {
+        if(root.instructions != nullptr){
+            root.instructions->accept(*this);
+        }
+    }
+    void visit(VarDeclStatement& root) { root.var->accept(*this); }
+    void visit(FuncDeclStatement&) {}
+    void visit(BlockStatement& root) {
+        locals.emplace_back();
+        for(auto item : root.instructions){
+            item->accept(*this);
+        }
+        locals.pop_back();
+    }
+private:
+    //у каждой функции свои локальные области: вызываемая не видит имён вызывающей
+    void follow(FuncDefinition& func) {
+        if(found || !visited.insert(&func).second || func.commandsList == nullptr){
+            return;
+        }
+        auto outer = std::exchange(locals, {{}});
+        for(auto arg : func.argsList){
+            locals.back().insert(arg->name);
+        }
+        func.commandsList->accept(*this);
+        locals = std::move(outer);
+    }
+
+    void write(expr target) {
+        auto id = dynamic_cast<IdentifierNode*>(target);
+        if(id == nullptr || found){
+            return;
+        }
+        for(auto& scope : locals){
+            if(scope.contains(id->name)){
+                return;
+            }
+        }
+        found = id->name;
+    }
+
+    SymbolStack& names;
+    std::vector<std::unordered_set<symbol>> locals;
+    std::unordered_set<FuncDefinition*> visited;
+    std::optional<symbol> found;
+};
+
+bool is_spawn(expr value) {
+    auto call = dynamic_cast<FunctionNode*>(value);
+    return call && call->name == symbols::spawn;
+}
+
+}
 
 void Analyzer::visit(BinaryNode& root) { 
     if(assignment_operations.contains(root.op)){
@@ -9,7 +130,7 @@ void Analyzer::visit(BinaryNode& root) {
             throw std::runtime_error("Sintaxis error, second =");
         }
         equalsFlag++;
-        if(!dynamic_cast<IdentifierNode*>(root.left_branch.get()) && !dynamic_cast<PrefixNode*>(root.left_branch.get())){
+        if(!dynamic_cast<IdentifierNode*>(root.left_branch) && !dynamic_cast<PrefixNode*>(root.left_branch)){
             throw std::runtime_error("Not lvalue on left side of =");
         }
     }
@@ -35,11 +156,11 @@ void Analyzer::visit(UnaryNode& root) {
 }
 
 void Analyzer::visit(PrefixNode& root) {
-    if(auto id = dynamic_pointer_cast<IdentifierNode>(root.branch)){
-        auto element = scope_control.scopes.top()->get_element(id->name);
-        if(auto var = dynamic_pointer_cast<VarDefinition>(element)){
+    if(auto id = dynamic_cast<IdentifierNode*>(root.branch)){
+        auto element = names.get_element(id->name);
+        if(auto var = dynamic_cast<VarDefinition*>(element)){
             if(var->const_specifier){
-                throw std::runtime_error(var->name + " is const");
+                throw std::runtime_error(spelling(var->name) + " is const");
             }else{
                 root.branch->accept(*this);
             }
@@ -56,11 +177,11 @@ void Analyzer::visit(PrefixNode& root) {
 
 void Analyzer::visit(PostfixNode& root) {
     root.branch->accept(*this);
-    if(auto id = dynamic_pointer_cast<IdentifierNode>(root.branch)){
-        auto element = scope_control.scopes.top()->get_element(id->name);
-        if(auto var = dynamic_pointer_cast<VarDefinition>(element)){
+    if(auto id = dynamic_cast<IdentifierNode*>(root.branch)){
+        auto element = names.get_element(id->name);
+        if(auto var = dynamic_cast<VarDefinition*>(element)){
             if(var->const_specifier){
-                throw std::runtime_error(var->name + " is const");
+                throw std::runtime_error(spelling(var->name) + " is const");
             }
         }else{
             throw std::runtime_error("Uncorrect identifierNode");
@@ -74,43 +195,111 @@ void Analyzer::visit(PostfixNode& root) {
 }
 
 void Analyzer::visit(FunctionNode& root){
-    if(root.name != "print" && root.name != "scan"){
-        auto decl = scope_control.scopes.top()->get_element(root.name);
-        if(decl == nullptr){
-            throw std::runtime_error("Undefined function " + root.name);
-        }
-        auto func = dynamic_pointer_cast<FuncDefinition>(decl);
-        if(root.branches.size() != func->argsList.size()){
-            throw std::runtime_error("Uncorrect quantity of params");
-        }
-        for(int i = 0; i < root.branches.size(); i++){
-            root.branches[i]->accept(*this);
-            auto lhs = currType;
-            auto rhs = get_type(func->argsList[i]->type);
-            if(lhs != rhs){
-                throw std::runtime_error("Uncorrect types of function params");
+    if(root.name == symbols::spawn){
+        check_spawn(root);
+        return;
+    }
+    if(root.name == symbols::join){
+        check_join(root);
+        return;
+    }
+    //scan пишет в свои аргументы, print их читает; проверка та же, что у присваивания и чтения
+    if(root.name == symbols::print || root.name == symbols::scan){
+        for(auto arg : root.branches){
+            if(root.name == symbols::scan){
+                if(!dynamic_cast<IdentifierNode*>(arg)){
+                    throw std::runtime_error("scan expects variables");
+                }
+                lhsFlag++;
+                equalsFlag++;
+                arg->accept(*this);
+                lhsFlag--;
+                equalsFlag--;
+            }else{
+                arg->accept(*this);
+                if(currType == Type::VOID){
+                    throw std::runtime_error("Can't print void");
+                }
             }
         }
+        currType = Type::VOID;
+        return;
+    }
+    auto decl = names.get_element(root.name);
+    if(decl == nullptr){
+        throw std::runtime_error("Undefined function " + spelling(root.name));
+    }
+    auto func = dynamic_cast<FuncDefinition*>(decl);
+    if(root.branches.size() != func->argsList.size()){
+        throw std::runtime_error("Uncorrect quantity of params");
+    }
+    for(int i = 0; i < root.branches.size(); i++){
+        root.branches[i]->accept(*this);
+        auto lhs = currType;
+        auto rhs = get_type(func->argsList[i]->type);
+        if(lhs != rhs){
+            throw std::runtime_error("Uncorrect types of function params");
+        }
     }
-    currType = scope_control.scopes.top()->search_type(root.name);
+    currType = names.search_type(root.name);
+}
+
+//задача исполняется параллельно с остальной программой, поэтому глобальные она только читает
+void Analyzer::check_spawn(FunctionNode& root){
+    if(!std::exchange(spawnFlag, false)){
+        throw std::runtime_error("spawn must initialize an int variable");
+    }
+    auto call = root.branches.size() == 1 ? dynamic_cast<FunctionNode*>(root.branches[0]) : nullptr;
+    auto func = call ? dynamic_cast<FuncDefinition*>(names.get_element(call->name)) : nullptr;
+    if(func == nullptr){
+        throw std::runtime_error("spawn expects a function call");
+    }
+    call->accept(*this);
+    spawned = currType;
+    if(auto global = GlobalWrites(names).find(*func)){
+        throw std::runtime_error("Task " + spelling(call->name) + " writes global " + spelling(*global));
+    }
+    currType = Type::INT;
+}
+
+void Analyzer::check_join(FunctionNode& root){
+    auto handle = root.branches.size() == 1 ? dynamic_cast<IdentifierNode*>(root.branches[0]) : nullptr;
+    auto task = handle ? tasks.find(names.get_element(handle->name)) : tasks.end();
+    if(task == tasks.end()){
+        throw std::runtime_error("join expects a task handle");
+    }
+    handle->accept(*this);
+    currType = task->second;
 }
 
 void Analyzer::visit(IdentifierNode& root){
-    currType = scope_control.scopes.top()->search_type(root.name);
+    auto& binding = names.resolve(root.name);
+    currType = binding.type;
+    //общие объявления параллельного анализа не меняются: присваивания и чтения до них уходят в итог тела
     if(lhsFlag && equalsFlag){
-        auto obj = scope_control.scopes.top()->get_element(root.name);
-        if(auto get = dynamic_cast<VarDefinition*>(obj.get())){
+        auto obj = binding.decl;
+        if(auto get = dynamic_cast<VarDefinition*>(obj)){
             if(get->const_specifier){
-                throw std::runtime_error("Const variable " + get->name);
+                throw std::runtime_error("Const variable " + spelling(get->name));
             }
-            (get->initialisedFlag)++;
         }
-        if(auto get = dynamic_cast<FuncDefinition*>(obj.get())){
+        if(names.shared(binding)){
+            if(std::ranges::find(unit->assigned, root.name) == unit->assigned.end()){
+                unit->assigned.push_back(root.name);
+            }
+        }else if(auto get = dynamic_cast<VarDefinition*>(obj)){
+            (get->initialisedFlag)++;
+        }else if(auto get = dynamic_cast<FuncDefinition*>(obj)){
             (get->initialisedFlag)++;
         }
     }else{
-        if(!scope_control.scopes.top()->cheak_init(root.name) && mainFlag){
-            throw std::runtime_error(root.name + " not initialized");
+        if(!SymbolStack::initialised(binding) && mainFlag){
+            if(!names.shared(binding)){
+                throw std::runtime_error(spelling(root.name) + " not initialized");
+            }
+            if(std::ranges::find(unit->assigned, root.name) == unit->assigned.end()){
+                unit->reads.push_back(root.name);
+            }
         }
     }
 }
@@ -137,14 +326,170 @@ void Analyzer::visit(ParenthesizedNode& root){
 
 /////////////////////////////////////////////////////
 void Analyzer::analyze(const std::vector<statement>& root){
-    scope_control.enterScope();
+    names.enterScope();
     for(int i = 0; i < root.size(); i++){
         root[i]->accept(*this);
     }
     if(mainFlag == 0){
         throw std::runtime_error("Main function was not declared");
     }
-    scope_control.exitScope();
+    names.exitScope();
+}
+
+void Analyzer::open_session(){
+    names.enterScope();
+    loopFlag.push(0);
+    mainFlag = 1;
+}
+
+//функции проверяются как объявленные до main: их параметры и глобальные инициализирует вызов
+void Analyzer::analyze_entry(const std::vector<statement>& entry){
+    for(auto item : entry){
+        auto function = dynamic_cast<FuncDeclStatement*>(item) != nullptr;
+        mainFlag = !function;
+        item->accept(*this);
+    }
+    mainFlag = 1;
+}
+
+void Analyzer::rollback(SymbolStack::Checkpoint point){
+    names.rollback(point);
+    mainFlag = 1;
+    loopFlag = {};
+    loopFlag.push(0);
+    anotherFunc = false;
+    equalsFlag = 0;
+    lhsFlag = 0;
+}
+
+void Analyzer::analyze_parallel(const std::vector<statement>& root, unsigned threads, std::vector<Unit>* cache){
+    if(threads == 0){
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if(cache == nullptr && (threads == 1 || root.size() < 2)){
+        analyze(root);
+        return;
+    }
+    check_declarations(root, threads, cache);
+    if(mainFlag == 0){
+        throw std::runtime_error("Main function was not declared");
+    }
+}
+
+void Analyzer::analyze_library(const std::vector<statement>& root, std::vector<Unit>& units, unsigned threads){
+    if(threads == 0){
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    check_declarations(root, threads, &units);
+}
+
+void Analyzer::check_declarations(const std::vector<statement>& root, unsigned threads, std::vector<Unit>* cache){
+
+    //фаза 1: объявления верхнего уровня по порядку, до первой ошибки регистрации
+    names.enterScope();
+    std::vector<std::uint32_t> main_seen(root.size());
+    std::size_t count = root.size();
+    std::exception_ptr declared;
+    bool declared_late = false;//повтор имени переменной обнаруживается после проверки её значения
+    for(std::size_t i = 0; i < root.size(); i++){
+        main_seen[i] = mainFlag;
+        declared_late = false;
+        try{
+            if(auto var = dynamic_cast<VarDeclStatement*>(root[i])){
+                auto& def = *var->var;
+                if(def.type == "void"){
+                    throw std::runtime_error("Variable can't be void type");
+                }
+                if(def.value != nullptr){
+                    def.initialisedFlag++;
+                }
+                declared_late = true;
+                names.add(def.name, arena.make<VarDefinition>(def), get_type(def.type), i);
+            }else if(auto func = dynamic_cast<FuncDeclStatement*>(root[i])){
+                auto& def = *func->func;
+                names.add(def.funcName, arena.make<FuncDefinition>(def), get_type(def.returnType), i);
+                if(def.funcName == symbols::main){
+                    mainFlag++;
+                }
+                main_seen[i] = mainFlag;
+            }
+        }catch(...){
+            declared = std::current_exception();
+            count = declared_late ? i + 1 : i;
+            break;
+        }
+    }
+
+    //фаза 2: тела и значения проверяются независимо, каждый поток со своим анализатором
+    std::vector<Unit> own;
+    auto& units = cache != nullptr ? *cache : own;
+    units.resize(root.size());
+    std::vector<std::size_t> pending;
+    for(std::size_t i = 0; i < count; i++){
+        if(!units[i].checked){
+            pending.push_back(i);
+        }
+    }
+    std::atomic<std::size_t> next = 0;
+    auto& interner = Interner::current();
+    auto worker = [&] {
+        Interner::Use use(interner);
+        Analyzer local;
+        for(auto job = next++; job < pending.size(); job = next++){
+            auto i = pending[job];
+            auto func = dynamic_cast<FuncDeclStatement*>(root[i]);
+            //функция видит себя ради рекурсии, переменная в своём значении - нет
+            local.names.share(&names, static_cast<std::uint32_t>(func != nullptr ? i + 1 : i));
+            local.mainFlag = main_seen[i];
+            local.check_unit(root[i], units[i]);
+        }
+    };
+    {
+        std::vector<std::jthread> pool;
+        for(unsigned i = 1; i < std::min<std::size_t>(threads, pending.size()); i++){
+            pool.emplace_back(worker);
+        }
+        worker();
+    }
+
+    //сведение по порядку объявлений: глобальное имя инициализировано значением или присваиванием в более раннем теле
+    std::unordered_set<symbol> assigned;
+    for(std::size_t i = 0; i < count; i++){
+        for(auto name : units[i].reads){
+            if(!assigned.contains(name) && !SymbolStack::initialised(*names.find(name))){
+                throw std::runtime_error(spelling(name) + " not initialized");
+            }
+        }
+        if(units[i].error){
+            std::rethrow_exception(units[i].error);
+        }
+        assigned.insert(units[i].assigned.begin(), units[i].assigned.end());
+    }
+    if(declared){
+        std::rethrow_exception(declared);
+    }
+    names.exitScope();
+}
+
+void Analyzer::check_unit(statement decl, Unit& result){
+    result = {};
+    unit = &result;
+    try{
+        if(auto var = dynamic_cast<VarDeclStatement*>(decl)){
+            if(var->var->value != nullptr){
+                check_value(*var->var);
+            }
+        }else if(auto func = dynamic_cast<FuncDeclStatement*>(decl)){
+            check_body(*func->func);
+        }
+    }catch(...){
+        result.error = std::current_exception();
+        names.reset();
+        loopFlag = {};
+        equalsFlag = lhsFlag = 0;
+    }
+    result.checked = true;
+    unit = nullptr;
 }
 
 void Analyzer::visit(VarDefinition& root){
@@ -153,43 +498,59 @@ void Analyzer::visit(VarDefinition& root){
     }
     if(root.value != nullptr){
         root.initialisedFlag++;
-        root.value->accept(*this);
-        switch(currType){
-            case Type::INT :
-                if(root.type != "int"){
-                    throw std::runtime_error("Variable not int");
-                }
-                break;
-            case Type::DOUBLE :
-                if(root.type != "double"){
-                    throw std::runtime_error("Variable not double");
-                }
-                break;
-            case Type::CHAR :
-                if(root.type != "char"){
-                    throw std::runtime_error("Variable not char");
-                }
-                break;
-            case Type::BOOL :
-                if(root.type != "bool"){
-                    throw std::runtime_error("Variable not bool");
-                }
-                break;
+        check_value(root);
+    }
+    auto copy = arena.make<VarDefinition>(root);
+    if(is_spawn(root.value)){
+        copy->const_specifier = true;//дескриптор не переприсваивается, чтобы join знал тип результата
+        tasks[copy] = spawned;
+    }
+    names.add(root.name, copy, get_type(root.type));
+}
+
+void Analyzer::check_value(VarDefinition& root){
+    if(is_spawn(root.value)){
+        if(loopFlag.empty()){
+            throw std::runtime_error("spawn is only allowed inside functions");
         }
+        spawnFlag = true;
+    }
+    root.value->accept(*this);
+    switch(currType){
+        case Type::INT :
+            if(root.type != "int"){
+                throw std::runtime_error("Variable not int");
+            }
+            break;
+        case Type::DOUBLE :
+            if(root.type != "double"){
+                throw std::runtime_error("Variable not double");
+            }
+            break;
+        case Type::CHAR :
+            if(root.type != "char"){
+                throw std::runtime_error("Variable not char");
+            }
+            break;
+        case Type::BOOL :
+            if(root.type != "bool"){
+                throw std::runtime_error("Variable not bool");
+            }
+            break;
     }
-    auto scope = scope_control.scopes.top();
-    scope->add(root.name, std::make_shared<VarDefinition>(root));
 }
 
 void Analyzer::visit(FuncDefinition& root){
-    auto scope = scope_control.scopes.top();
-    scope->add(root.funcName, std::make_shared<FuncDefinition>(root));
-    scope_control.enterScope();
-    loopFlag.push(0);
-
-    if(root.funcName == "main"){
+    names.add(root.funcName, arena.make<FuncDefinition>(root), get_type(root.returnType));
+    if(root.funcName == symbols::main){
         mainFlag++;
     }
+    check_body(root);
+}
+
+void Analyzer::check_body(FuncDefinition& root){
+    names.enterScope();
+    loopFlag.push(0);
 
     for(int i = 0; i < root.argsList.size(); i++){
         root.argsList[i]->accept(*this);
@@ -199,10 +560,10 @@ void Analyzer::visit(FuncDefinition& root){
         root.commandsList->accept(*this);
     }
 
-    auto block = dynamic_cast<BlockStatement*>(root.commandsList.get());
+    auto block = dynamic_cast<BlockStatement*>(root.commandsList);
     int flag = 0;
     for(int i = 0; block && i < block->instructions.size(); i++){
-        if(auto jump = dynamic_cast<JumpStatement*>(block->instructions[i].get())){
+        if(auto jump = dynamic_cast<JumpStatement*>(block->instructions[i])){
             flag++;
             if(jump->jumpName == "return"){
                 if(jump->instructions == nullptr){
@@ -235,7 +596,7 @@ void Analyzer::visit(FuncDefinition& root){
                     }
                 }
             }else{
-                throw std::runtime_error("break or continue in function " + root.funcName);
+                throw std::runtime_error("break or continue in function " + spelling(root.funcName));
             }
         }
     }
@@ -243,7 +604,7 @@ void Analyzer::visit(FuncDefinition& root){
         throw std::runtime_error("Non void function");
     }
 
-    scope_control.exitScope();
+    names.exitScope();
     loopFlag.pop();
 }
 
@@ -258,7 +619,7 @@ void Analyzer::visit(ExprStatement& root){
 }
 
 void Analyzer::visit(CondStatement& root){
-    scope_control.enterScope();
+    names.enterScope();
     if(root.condition != nullptr){
        root.condition->accept(*this); 
     }
@@ -268,13 +629,13 @@ void Analyzer::visit(CondStatement& root){
     if(root.else_instruction != nullptr){
         root.else_instruction->accept(*this);
     }
-    scope_control.exitScope();
+    names.exitScope();
 }
 
 void Analyzer::visit(ForLoopStatement& root){}
 
 void Analyzer::visit(WhileLoopStatement& root){
-    scope_control.enterScope();
+    names.enterScope();
     if(root.condition != nullptr){
         root.condition->accept(*this);
     }
@@ -283,7 +644,7 @@ void Analyzer::visit(WhileLoopStatement& root){
         root.instructions->accept(*this);
         (loopFlag.top())--;
     }
-    scope_control.exitScope();
+    names.exitScope();
 }
 
 void Analyzer::visit(JumpStatement& root){
@@ -308,4 +669,266 @@ Type Analyzer::get_type(const std::string& type) {
 	else return Type::BOOL;
 }
 
-const std::unordered_set<std::string> Analyzer::assignment_operations = {"=", "+=", "-=", "*=", "/="};
\ No newline at end of file
+std::uint32_t Analyzer::version() {
+    return analyzer_version;
+}
+
+std::string Analyzer::signature(statement decl) {
+    std::string result;
+    if(auto var = dynamic_cast<VarDeclStatement*>(decl)){
+        result = "v " + var->var->type + (var->var->const_specifier ? " const" : "") + (var->var->value != nullptr ? " =" : "");
+    }else if(auto func = dynamic_cast<FuncDeclStatement*>(decl)){
+        result = "f " + func->func->returnType;
+        for(auto arg : func->func->argsList){
+            result += " " + arg->type;
+        }
+    }
+    return result;
+}
+
+const std::unordered_set<std::string> Analyzer::assignment_operations = {"=", "+=", "-=", "*=", "/="};
+/////////////////////////////////////////////////////плоское AST
+void Analyzer::analyze(const FlatAst& ast){
+    names.enterScope();
+    for(auto root : ast.roots){
+        check(ast, root);
+    }
+    if(mainFlag == 0){
+        throw std::runtime_error("Main function was not declared");
+    }
+    names.exitScope();
+}
+
+//проверки те же, что в visit; в таблицы областей попадают объявления из арены анализатора
+void Analyzer::check(const FlatAst& ast, node_id id){
+    auto& root = ast[id];
+    auto check_numeric = [&](const char* message){
+        if(currType == Type::CHAR || currType == Type::BOOL || currType == Type::VOID){
+            throw std::runtime_error(message);
+        }
+    };
+    auto mutable_variable = [&](node_id operand){
+        auto element = names.get_element(ast[operand].a);
+        if(auto var = dynamic_cast<VarDefinition*>(element)){
+            if(var->const_specifier){
+                throw std::runtime_error(spelling(var->name) + " is const");
+            }
+        }else{
+            throw std::runtime_error("Uncorrect identifierNode");
+        }
+    };
+    switch(root.kind){
+        case NodeKind::BINARY: {
+            bool assignment = root.op >= Op::ASSIGN && root.op <= Op::DIV_ASSIGN;
+            if(assignment){
+                if(equalsFlag > 0){
+                    throw std::runtime_error("Sintaxis error, second =");
+                }
+                equalsFlag++;
+                if(ast[root.a].kind != NodeKind::IDENTIFIER && ast[root.a].kind != NodeKind::PREFIX){
+                    throw std::runtime_error("Not lvalue on left side of =");
+                }
+            }
+            lhsFlag++;
+            check(ast, root.a);
+            lhsFlag--;
+            auto lhs = currType;
+            check(ast, root.b);
+            if(lhs != currType){
+                throw std::runtime_error("Uncorrect types");
+            }
+            if(root.op == Op::ASSIGN){
+                equalsFlag--;
+            }
+            break;
+        }
+        case NodeKind::UNARY:
+            check(ast, root.a);
+            check_numeric("Uncorrect unary operation");
+            break;
+        case NodeKind::PREFIX:
+            if(ast[root.a].kind != NodeKind::IDENTIFIER){
+                throw std::runtime_error("Uncorrect prefix operand");
+            }
+            mutable_variable(root.a);
+            check(ast, root.a);
+            check_numeric("Uncorrect prefix operation");
+            break;
+        case NodeKind::POSTFIX:
+            check(ast, root.a);
+            if(ast[root.a].kind != NodeKind::IDENTIFIER){
+                throw std::runtime_error("Uncorrect postfix operand");
+            }
+            mutable_variable(root.a);
+            check_numeric("Uncorrect postfix operation");
+            break;
+        case NodeKind::CALL:
+            if(root.a == symbols::print || root.a == symbols::scan){
+                for(auto arg : ast.list(root.c)){
+                    if(root.a == symbols::scan){
+                        if(ast.nodes[arg].kind != NodeKind::IDENTIFIER){
+                            throw std::runtime_error("scan expects variables");
+                        }
+                        lhsFlag++;
+                        equalsFlag++;
+                        check(ast, arg);
+                        lhsFlag--;
+                        equalsFlag--;
+                    }else{
+                        check(ast, arg);
+                        if(currType == Type::VOID){
+                            throw std::runtime_error("Can't print void");
+                        }
+                    }
+                }
+            }else{
+                auto func = dynamic_cast<FuncDefinition*>(names.get_element(root.a));
+                if(func == nullptr){
+                    throw std::runtime_error("Undefined function " + spelling(root.a));
+                }
+                auto args = ast.list(root.c);
+                if(args.size() != func->argsList.size()){
+                    throw std::runtime_error("Uncorrect quantity of params");
+                }
+                for(std::size_t i = 0; i < args.size(); i++){
+                    check(ast, args[i]);
+                    if(currType != get_type(func->argsList[i]->type)){
+                        throw std::runtime_error("Uncorrect types of function params");
+                    }
+                }
+            }
+            currType = names.search_type(root.a);
+            break;
+        case NodeKind::IDENTIFIER: {
+            auto& binding = names.resolve(root.a);
+            currType = binding.type;
+            if(lhsFlag && equalsFlag){
+                auto obj = binding.decl;
+                if(auto get = dynamic_cast<VarDefinition*>(obj)){
+                    if(get->const_specifier){
+                        throw std::runtime_error("Const variable " + spelling(get->name));
+                    }
+                    (get->initialisedFlag)++;
+                }
+                if(auto get = dynamic_cast<FuncDefinition*>(obj)){
+                    (get->initialisedFlag)++;
+                }
+            }else if(!SymbolStack::initialised(binding) && mainFlag){
+                throw std::runtime_error(spelling(root.a) + " not initialized");
+            }
+            break;
+        }
+        case NodeKind::INT:
+        case NodeKind::DOUBLE:
+        case NodeKind::CHAR:
+        case NodeKind::BOOL:
+            currType = root.type;
+            break;
+        case NodeKind::PARENTHESIZED:
+        case NodeKind::EXPR:
+            check(ast, root.a);
+            break;
+        case NodeKind::VAR_DEF: {
+            if(root.type == Type::VOID){
+                throw std::runtime_error("Variable can't be void type");
+            }
+            auto var = arena.make<VarDefinition>(std::string(FlatAst::spelling(root.type)), root.a, nullptr, root.constant);
+            if(root.b != no_node){
+                var->initialisedFlag++;
+                check(ast, root.b);
+                if(currType != Type::VOID && currType != root.type){
+                    throw std::runtime_error("Variable not " + std::string(FlatAst::spelling(currType)));
+                }
+            }
+            names.add(root.a, var, root.type);
+            break;
+        }
+        case NodeKind::FUNC_DEF:
+            check_function(ast, id);
+            break;
+        case NodeKind::BLOCK:
+            for(auto instruction : ast.list(root.c)){
+                check(ast, instruction);
+            }
+            break;
+        case NodeKind::COND:
+            names.enterScope();
+            if(root.a != no_node){
+                check(ast, root.a);
+                if(root.b != no_node){
+                    check(ast, root.b);
+                }
+            }
+            if(root.c != no_node){
+                check(ast, root.c);
+            }
+            names.exitScope();
+            break;
+        case NodeKind::WHILE:
+            names.enterScope();
+            if(root.a != no_node){
+                check(ast, root.a);
+            }
+            if(root.b != no_node){
+                (loopFlag.top())++;
+                check(ast, root.b);
+                (loopFlag.top())--;
+            }
+            names.exitScope();
+            break;
+        case NodeKind::JUMP:
+            if(loopFlag.top() == 0 && root.op != Op::RETURN){
+                throw std::runtime_error("Break or continue jump not inside loopStatement");
+            }
+            break;
+    }
+}
+
+void Analyzer::check_function(const FlatAst& ast, node_id id){
+    auto& root = ast[id];
+    std::pmr::vector<VarDefinition*> params(&arena);
+    for(auto param : ast.list(root.c)){
+        params.push_back(arena.make<VarDefinition>(std::string(FlatAst::spelling(ast[param].type)), ast[param].a, nullptr, ast[param].constant));
+    }
+    names.add(root.a, arena.make<FuncDefinition>(std::string(FlatAst::spelling(root.type)), root.a, std::move(params), nullptr), root.type);
+    names.enterScope();
+    loopFlag.push(0);
+
+    if(root.a == symbols::main){
+        mainFlag++;
+    }
+    for(auto param : ast.list(root.c)){
+        check(ast, param);
+    }
+    if(root.b != no_node){
+        check(ast, root.b);
+    }
+
+    int flag = 0;
+    for(auto instruction : root.b != no_node ? ast.list(ast[root.b].c) : std::span<const node_id>{}){
+        auto& jump = ast[instruction];
+        if(jump.kind != NodeKind::JUMP){
+            continue;
+        }
+        flag++;
+        if(jump.op != Op::RETURN){
+            throw std::runtime_error("break or continue in function " + spelling(root.a));
+        }
+        if(jump.a == no_node){
+            if(root.type != Type::VOID){
+                throw std::runtime_error("Non void function");
+            }
+        }else{
+            check(ast, jump.a);
+            if(currType != Type::VOID && currType != root.type){
+                throw std::runtime_error("Retruned not " + std::string(FlatAst::spelling(currType)));
+            }
+        }
+    }
+    if(!flag && root.type != Type::VOID){
+        throw std::runtime_error("Non void function");
+    }
+
+    names.exitScope();
+    loopFlag.pop();
+}
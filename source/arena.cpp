@@ -0,0 +1,38 @@
+#include <cstdint>
+
+#include "arena.hpp"
+
+Arena::Arena(std::size_t block_size) : block_size(block_size) {}
+
+Arena::~Arena() {
+    for(auto finalizer = finalizers; finalizer != nullptr; finalizer = finalizer->next){
+        finalizer->destroy(finalizer->object);
+    }
+}
+
+void Arena::adopt(std::unique_ptr<Arena> other) {
+    count += other->count;
+    used += other->used;
+    adopted.push_back(std::move(other));
+}
+
+void* Arena::do_allocate(std::size_t size, std::size_t alignment) {
+    auto align = [alignment](std::byte* pointer) {
+        auto address = reinterpret_cast<std::uintptr_t>(pointer);
+        return reinterpret_cast<std::byte*>((address + alignment - 1) & ~(alignment - 1));
+    };
+    count++;
+    used += size;
+    //крупные запросы получают собственный блок, текущий остаётся для мелких
+    if(size + alignment > block_size / 4){
+        auto& block = blocks.emplace_back(new std::byte[size + alignment]);
+        return align(block.get());
+    }
+    if(cursor == nullptr || align(cursor) + size > limit){
+        cursor = blocks.emplace_back(new std::byte[block_size]).get();
+        limit = cursor + block_size;
+    }
+    auto result = align(cursor);
+    cursor = result + size;
+    return result;
+}
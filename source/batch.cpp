@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "batch.hpp"
+#include "operations.hpp"
+
+namespace {
+
+template<class V>
+using logical_t = std::conditional_t<std::is_same_v<typename V::value_type, std::uint8_t>, bool, typename V::value_type>;
+
+template<class T>
+using lane_t = std::conditional_t<std::is_same_v<T, bool>, std::uint8_t, T>;
+
+bool any(const lanes& mask) {
+    return std::any_of(mask.begin(), mask.end(), [](std::uint8_t lane) { return lane; });
+}
+
+lanes both(const lanes& lhs, const lanes& rhs) {
+    lanes result(lhs.size());
+    for(std::size_t i = 0; i < lhs.size(); i++){
+        result[i] = lhs[i] & rhs[i];
+    }
+    return result;
+}
+
+lanes except(const lanes& lhs, const lanes& rhs) {
+    lanes result(lhs.size());
+    for(std::size_t i = 0; i < lhs.size(); i++){
+        result[i] = lhs[i] & !rhs[i];
+    }
+    return result;
+}
+
+void merge(lanes& into, const lanes& from) {
+    for(std::size_t i = 0; i < into.size(); i++){
+        into[i] |= from[i];
+    }
+}
+
+column broadcast(const operand& value, std::size_t width) {
+    return std::visit([&](auto arg) -> column { return std::vector<lane_t<decltype(arg)>>(width, arg); }, value);
+}
+
+const lanes& condition(const column& value) {
+    if(auto cond = std::get_if<std::vector<std::uint8_t>>(&value)){
+        return *cond;
+    }
+    throw std::runtime_error("Batch: condition is not bool");
+}
+
+//ядра ниже - плоские циклы по непрерывным массивам, компилятор раскладывает их по SIMD-регистрам
+template<class Op>
+column apply(const column& lhs, const column& rhs, const lanes& mask) {
+    return std::visit([&](const auto& a, const auto& b) -> column {
+        using L = logical_t<std::decay_t<decltype(a)>>;
+        using R = logical_t<std::decay_t<decltype(b)>>;
+        using T = decltype(Op{}(L{}, R{}));
+        std::vector<lane_t<T>> result(a.size());
+        for(std::size_t i = 0; i < a.size(); i++){
+            if constexpr (std::is_same_v<Op, std::divides<>> && std::is_integral_v<R>){
+                //неактивные строки не должны падать на целочисленном делении на ноль
+                auto divisor = mask[i] ? static_cast<R>(b[i]) : R(1);
+                result[i] = Op{}(static_cast<L>(a[i]), divisor);
+            }else{
+                result[i] = Op{}(static_cast<L>(a[i]), static_cast<R>(b[i]));
+            }
+        }
+        return result;
+    }, lhs, rhs);
+}
+
+template<class Op>
+column apply(const column& value) {
+    return std::visit([&](const auto& a) -> column {
+        using L = logical_t<std::decay_t<decltype(a)>>;
+        using T = decltype(Op{}(L{}));
+        std::vector<lane_t<T>> result(a.size());
+        for(std::size_t i = 0; i < a.size(); i++){
+            result[i] = Op{}(static_cast<L>(a[i]));
+        }
+        return result;
+    }, value);
+}
+
+template<class T>
+T parse_value(const char* begin, const char* end) {
+    if constexpr (std::is_same_v<T, char>){
+        return begin != end ? *begin : '\0';
+    }else if constexpr (std::is_same_v<T, std::uint8_t>){
+        return std::string_view(begin, end - begin) == "true" || std::string_view(begin, end - begin) == "1";
+    }else{
+        T value{};
+        if(std::from_chars(begin, end, value).ec != std::errc{}){
+            throw std::runtime_error("Batch: bad value " + std::string(begin, end));
+        }
+        return value;
+    }
+}
+
+}
+
+BatchExecutor::BatchExecutor(const std::vector<statement>& root) : program(root) {
+    for(const auto& decl : program){
+        if(auto func = dynamic_cast<FuncDeclStatement*>(decl)){
+            functions[func->func->funcName] = func->func;
+        }
+    }
+}
+
+void BatchExecutor::run(const std::string& name, std::istream& in, std::ostream& out) {
+    auto id = Interner::current().intern(name);
+    if(!functions.contains(id)){
+        throw std::runtime_error("Batch: undefined function " + name);
+    }
+    auto& func = *functions.at(id);
+    std::vector<column> args;
+    for(const auto& arg : func.argsList){
+        args.push_back(broadcast(Executor::default_value(Executor::get_type(arg->type)), 0));
+    }
+
+    std::string line;
+    bool eof = false;
+    while(!eof){
+        for(auto& arg : args){
+            std::visit([](auto& values) { values.clear(); }, arg);
+        }
+        width = 0;
+        while(width < block_size && !(eof = !std::getline(in, line))){
+            if(line.find_first_not_of(" \t\r") == std::string::npos){
+                continue;
+            }
+            const char* position = line.data();
+            const char* end = line.data() + line.size();
+            for(auto& arg : args){
+                while(position != end && std::isspace(static_cast<unsigned char>(*position))){
+                    position++;
+                }
+                auto start = position;
+                while(position != end && !std::isspace(static_cast<unsigned char>(*position))){
+                    position++;
+                }
+                std::visit([&](auto& values) {
+                    values.push_back(parse_value<typename std::decay_t<decltype(values)>::value_type>(start, position));
+                }, arg);
+            }
+            width++;
+        }
+        if(width == 0){
+            break;
+        }
+
+        mask.assign(width, 1);
+        globals.clear();
+        for(const auto& decl : program){
+            if(dynamic_cast<VarDeclStatement*>(decl)){
+                decl->accept(*this);
+            }
+        }
+        auto result = call(func, args);
+        std::visit([&](const auto& values) {
+            using T = logical_t<std::decay_t<decltype(values)>>;
+            for(const auto& value : values){
+                out << static_cast<T>(value) << '\n';
+            }
+        }, result);
+    }
+}
+
+column BatchExecutor::call(FuncDefinition& func, std::vector<column>& args) {
+    auto type = Executor::get_type(func.returnType);
+    auto fallback = broadcast(type == Type::VOID ? operand(0) : Executor::default_value(type), width);
+    if(!any(mask)){
+        return fallback;
+    }
+    Frame frame;
+    frame.scopes.emplace_back();
+    frame.returned.assign(width, 0);
+    for(std::size_t i = 0; i < func.argsList.size(); i++){
+        frame.scopes.back()[func.argsList[i]->name] = std::move(args[i]);
+    }
+    frames.push_back(std::move(frame));
+    auto entry = mask;
+    if(func.commandsList != nullptr){
+        func.commandsList->accept(*this);
+    }
+    auto result = frames.back().has_result ? std::move(frames.back().result) : std::move(fallback);
+    frames.pop_back();
+    mask = entry;
+    return result;
+}
+
+column* BatchExecutor::lookup(symbol name) {
+    if(!frames.empty()){
+        auto& scopes = frames.back().scopes;
+        for(auto it = scopes.rbegin(); it != scopes.rend(); ++it){
+            if(auto found = it->find(name); found != it->end()){
+                return &found->second;
+            }
+        }
+    }
+    if(auto found = globals.find(name); found != globals.end()){
+        return &found->second;
+    }
+    throw std::runtime_error("Batch: undefined symbol " + spelling(name));
+}
+
+column* BatchExecutor::target(const expr& root) {
+    if(auto id = dynamic_cast<IdentifierNode*>(root)){
+        return lookup(id->name);
+    }
+    if(auto prefix = dynamic_cast<PrefixNode*>(root)){
+        return target(prefix->branch);
+    }
+    if(auto parenthesized = dynamic_cast<ParenthesizedNode*>(root)){
+        return target(parenthesized->expression);
+    }
+    throw std::runtime_error("Batch: not lvalue");
+}
+
+//запись только в активные строки
+void BatchExecutor::assign(column& into, const column& value) {
+    if(into.index() != value.index()){
+        throw std::runtime_error("Batch: variable changes its type");
+    }
+    std::visit([&](auto& lhs) {
+        const auto& rhs = std::get<std::decay_t<decltype(lhs)>>(value);
+        for(std::size_t i = 0; i < lhs.size(); i++){
+            lhs[i] = mask[i] ? rhs[i] : lhs[i];
+        }
+    }, into);
+}
+
+//после ветвления активны только строки, не ушедшие через return/break/continue
+void BatchExecutor::settle(const lanes& entry) {
+    if(frames.empty()){
+        mask = entry;
+        return;
+    }
+    auto& frame = frames.back();
+    mask = except(entry, frame.returned);
+    if(!frame.loops.empty()){
+        mask = except(except(mask, frame.loops.back().broken), frame.loops.back().continued);
+    }
+}
+
+void BatchExecutor::declare(symbol name, column value) {
+    auto& scope = frames.empty() ? globals : frames.back().scopes.back();
+    if(scope.contains(name)){
+        throw std::runtime_error("Redeclaration of symbol " + spelling(name) + ".");
+    }
+    scope[name] = std::move(value);
+}
+
+void BatchExecutor::visit(BinaryNode& root) {
+    root.left_branch->accept(*this);
+    auto lhs = std::move(curr);
+    root.right_branch->accept(*this);
+    if(Analyzer::assignment_operations.contains(root.op)){
+        with_assignment_operation(root.op, [&](auto op) {
+            assign(*target(root.left_branch), apply<decltype(op)>(lhs, curr, mask));
+        });
+        return;
+    }
+    if(!with_binary_operation(root.op, [&](auto op) { curr = apply<decltype(op)>(lhs, curr, mask); })){
+        throw std::runtime_error("Batch: unsupported operator " + root.op);
+    }
+}
+
+void BatchExecutor::visit(UnaryNode& root) {
+    root.branch->accept(*this);
+    if(!with_unary_operation(root.op, [&](auto op) { curr = apply<decltype(op)>(curr); })){
+        throw std::runtime_error("Batch: unsupported operator " + root.op);
+    }
+}
+
+void BatchExecutor::visit(PostfixNode& root) {
+    root.branch->accept(*this);
+    auto var = target(root.branch);
+    with_unary_operation(root.op, [&](auto op) { assign(*var, apply<decltype(op)>(curr)); });
+    curr = *var;
+}
+
+void BatchExecutor::visit(PrefixNode& root) {
+    root.branch->accept(*this);
+    auto var = target(root.branch);
+    with_unary_operation(root.op, [&](auto op) { assign(*var, apply<decltype(op)>(curr)); });
+    curr = *var;
+}
+
+void BatchExecutor::visit(FunctionNode& root) {
+    if(!functions.contains(root.name)){
+        throw std::runtime_error("Batch: function " + spelling(root.name) + " is not supported");
+    }
+    std::vector<column> args;
+    for(const auto& branch : root.branches){
+        branch->accept(*this);
+        args.push_back(std::move(curr));
+    }
+    curr = call(*functions.at(root.name), args);
+}
+
+void BatchExecutor::visit(IdentifierNode& root) {
+    curr = *lookup(root.name);
+}
+
+void BatchExecutor::visit(IntNode& root) {
+    curr = broadcast(root.value, width);
+}
+
+void BatchExecutor::visit(DoubleNode& root) {
+    curr = broadcast(root.value, width);
+}
+
+void BatchExecutor::visit(CharNode& root) {
+    curr = broadcast(root.value, width);
+}
+
+void BatchExecutor::visit(BoolNode& root) {
+    curr = broadcast(root.value, width);
+}
+
+void BatchExecutor::visit(ParenthesizedNode& root) {
+    root.expression->accept(*this);
+}
+
+void BatchExecutor::visit(VarDefinition& root) {
+    if(root.value){
+        root.value->accept(*this);
+    }else{
+        curr = broadcast(Executor::default_value(Executor::get_type(root.type)), width);
+    }
+    declare(root.name, std::move(curr));
+}
+
+void BatchExecutor::visit(FuncDefinition& root) {
+    throw std::runtime_error("Batch: nested function " + spelling(root.funcName));
+}
+
+void BatchExecutor::visit(ExprStatement& root) {
+    root.expression->accept(*this);
+}
+
+void BatchExecutor::visit(CondStatement& root) {
+    root.condition->accept(*this);
+    auto cond = condition(curr);
+    auto entry = mask;
+    mask = both(entry, cond);
+    if(any(mask) && root.if_instruction){
+        frames.back().scopes.emplace_back();
+        root.if_instruction->accept(*this);
+        frames.back().scopes.pop_back();
+    }
+    mask = except(entry, cond);
+    if(any(mask) && root.else_instruction){
+        root.else_instruction->accept(*this);
+    }
+    settle(entry);
+}
+
+void BatchExecutor::visit(ForLoopStatement&) {}
+
+void BatchExecutor::visit(WhileLoopStatement& root) {
+    auto entry = mask;
+    frames.back().loops.push_back(Loop{lanes(width, 0), lanes(width, 0)});
+    auto live = entry;
+    while(true){
+        mask = live;
+        root.condition->accept(*this);
+        live = both(live, condition(curr));
+        if(!any(live)){
+            break;
+        }
+        mask = live;
+        frames.back().scopes.emplace_back();
+        if(root.instructions){
+            root.instructions->accept(*this);
+        }
+        frames.back().scopes.pop_back();
+        auto& loop = frames.back().loops.back();
+        live = except(except(live, loop.broken), frames.back().returned);
+        std::fill(loop.continued.begin(), loop.continued.end(), 0);
+    }
+    frames.back().loops.pop_back();
+    settle(entry);
+}
+
+void BatchExecutor::visit(JumpStatement& root) {
+    if(root.instructions){
+        root.instructions->accept(*this);
+    }
+    auto& frame = frames.back();
+    if(root.jumpName == "return"){
+        if(root.instructions){
+            if(!frame.has_result){
+                frame.result = curr;
+                frame.has_result = true;
+            }else{
+                assign(frame.result, curr);
+            }
+        }
+        merge(frame.returned, mask);
+    }else if(root.jumpName == "break"){
+        merge(frame.loops.back().broken, mask);
+    }else{
+        merge(frame.loops.back().continued, mask);
+    }
+    std::fill(mask.begin(), mask.end(), 0);
+}
+
+void BatchExecutor::visit(VarDeclStatement& root) {
+    root.var->accept(*this);
+}
+
+void BatchExecutor::visit(FuncDeclStatement& root) {
+    root.func->accept(*this);
+}
+
+void BatchExecutor::visit(BlockStatement& root) {
+    for(std::size_t i = 0; i < root.instructions.size() && any(mask); i++){
+        root.instructions[i]->accept(*this);
+    }
+}
@@ -0,0 +1,34 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "cache.hpp"
+
+std::filesystem::path cache_directory(){
+    std::filesystem::path dir;
+    if(auto env = std::getenv("INTERPRETER_CACHE")){
+        dir = env;
+    }else if(auto env = std::getenv("XDG_CACHE_HOME")){
+        dir = std::filesystem::path(env) / "interpreter";
+    }else if(auto env = std::getenv("HOME")){
+        dir = std::filesystem::path(env) / ".cache" / "interpreter";
+    }else{
+        dir = std::filesystem::temp_directory_path() / "interpreter";
+    }
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+std::uint64_t content_hash(std::string_view text, std::uint64_t seed){
+    auto hash = seed;
+    for(unsigned char c : text){
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string hex(std::uint64_t value){
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(value));
+    return name;
+}
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "call_graph.hpp"
+
+CallGraph::CallGraph(const std::vector<statement>& root, bool variables) : program(root), variables(variables) {
+    std::unordered_set<symbol> declared;
+    //повтор имени ловится здесь, иначе его пропустил бы анализ отброшенной функции
+    auto declare = [&](symbol name){
+        if(!declared.insert(name).second){
+            throw std::runtime_error("Redeclaration of symbol " + spelling(name) + ".");
+        }
+    };
+    for(auto decl : program){
+        if(auto var = dynamic_cast<VarDeclStatement*>(decl)){
+            declare(var->var->name);
+            current = &globals;
+        }else if(auto func = dynamic_cast<FuncDeclStatement*>(decl)){
+            declare(func->func->funcName);
+        }
+        decl->accept(*this);
+        current = nullptr;
+    }
+}
+
+std::vector<statement> CallGraph::reachable(const std::vector<symbol>& roots) const {
+    std::unordered_set<symbol> seen;
+    std::vector<symbol> pending(globals);
+    pending.insert(pending.end(), roots.begin(), roots.end());
+    while(!pending.empty()){
+        auto name = pending.back();
+        pending.pop_back();
+        if(seen.insert(name).second){
+            auto& next = callees(name);
+            pending.insert(pending.end(), next.begin(), next.end());
+        }
+    }
+    std::vector<statement> result;
+    for(auto decl : program){
+        auto func = dynamic_cast<FuncDeclStatement*>(decl);
+        if(func == nullptr || seen.contains(func->func->funcName)){
+            result.push_back(decl);
+        }
+    }
+    return result;
+}
+
+std::vector<symbol> CallGraph::references(statement decl) {
+    CallGraph graph({decl}, true);
+    auto func = dynamic_cast<FuncDeclStatement*>(decl);
+    auto names = func != nullptr ? graph.callees(func->func->funcName) : graph.initializers();
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    return names;
+}
+
+const std::vector<symbol>& CallGraph::callees(symbol name) const {
+    static const std::vector<symbol> none;
+    auto it = calls.find(name);
+    return it == calls.end() ? none : it->second;
+}
+
+void CallGraph::visit(BinaryNode& root) {
+    root.left_branch->accept(*this);
+    root.right_branch->accept(*this);
+}
+
+void CallGraph::visit(UnaryNode& root) {
+    root.branch->accept(*this);
+}
+
+void CallGraph::visit(FunctionNode& root) {
+    if(root.name != symbols::print && root.name != symbols::scan){
+        current->push_back(root.name);
+    }
+    for(auto arg : root.branches){
+        arg->accept(*this);
+    }
+}
+
+void CallGraph::visit(IdentifierNode& root) {
+    if(variables){
+        current->push_back(root.name);
+    }
+}
+void CallGraph::visit(IntNode&) {}
+void CallGraph::visit(DoubleNode&) {}
+void CallGraph::visit(CharNode&) {}
+void CallGraph::visit(BoolNode&) {}
+
+void CallGraph::visit(ParenthesizedNode& root) {
+    root.expression->accept(*this);
+}
+
+void CallGraph::visit(FuncDefinition& root) {
+    current = &calls[root.funcName];
+    if(root.commandsList != nullptr){
+        root.commandsList->accept(*this);
+    }
+}
+
+void CallGraph::visit(VarDefinition& root) {
+    if(root.value != nullptr){
+        root.value->accept(*this);
+    }
+}
+
+void CallGraph::visit(ExprStatement& root) {
+    root.expression->accept(*this);
+}
+
+void CallGraph::visit(CondStatement& root) {
+    root.condition->accept(*this);
+    root.if_instruction->accept(*this);
+    if(root.else_instruction != nullptr){
+        root.else_instruction->accept(*this);
+    }
+}
+
+void CallGraph::visit(ForLoopStatement& root) {
+    for(auto pre : root.preInstructions){
+        pre->accept(*this);
+    }
+    for(auto part : {root.condition, root.postInstructions}){
+        if(part != nullptr){
+            part->accept(*this);
+        }
+    }
+    if(root.instructions != nullptr){
+        root.instructions->accept(*this);
+    }
+}
+
+void CallGraph::visit(WhileLoopStatement& root) {
+    root.condition->accept(*this);
+    if(root.instructions != nullptr){
+        root.instructions->accept(*this);
+    }
+}
+
+void CallGraph::visit(JumpStatement& root) {
+    if(root.instructions != nullptr){
+        root.instructions->accept(*this);
+    }
+}
+
+void CallGraph::visit(PostfixNode& root) {
+    root.branch->accept(*this);
+}
+
+void CallGraph::visit(PrefixNode& root) {
+    root.branch->accept(*this);
+}
+
+void CallGraph::visit(VarDeclStatement& root) {
+    root.var->accept(*this);
+}
+
+void CallGraph::visit(FuncDeclStatement& root) {
+    root.func->accept(*this);
+}
+
+void CallGraph::visit(BlockStatement& root) {
+    for(auto instruction : root.instructions){
+        instruction->accept(*this);
+    }
+}
@@ -1,9 +1,43 @@
 #pragma once
+#include <array>
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include "visitor.hpp"
+#include "scheduler.hpp"
+#include "trace.hpp"
 
 using variable = std::variant<int, double, char, bool>;
 
+struct Executor::Tasks {
+    struct Result {
+        std::atomic<bool> done = false;//join ждёт его через wait
+        std::atomic<bool> observed = false;//ошибку уже получил join или исполнитель
+        variable value;
+        std::exception_ptr error;
+    };
+
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Result>> results;//номер итога - дескриптор задачи
+    std::atomic<std::size_t> running = 0;//отправленные и не завершённые задачи этого исполнения
+    std::mutex io;//print и scan разных задач не перемешиваются
+};
+
+Executor::Executor(std::istream& input, std::ostream& output) : input(input), output(output) {}
+
+//ошибку задачи, которую не дождались, деструктор не может бросить - только сообщить
+Executor::~Executor() {
+    try{
+        if(auto error = unjoined_error()){
+            std::rethrow_exception(error);
+        }
+    }
+    catch(const std::exception& error){
+        std::cerr << "error: unjoined task failed: " << error.what() << std::endl;
+    }
+}
+
 Type Executor::get_type(std::string type) {
 	if(type == "int") 
 		return Type::INT;
@@ -26,8 +60,8 @@ variable Executor::default_value(Type type) {
 	else return false;
 }
 
-std::vector<std::pair<std::string, std::shared_ptr<Variable>>> Executor::get_arguments(std::vector<std::shared_ptr<VarDefinition>> root){
-	std::vector<std::pair<std::string, std::shared_ptr<Variable>>> args;
+std::vector<std::pair<symbol, std::shared_ptr<Variable>>> Executor::get_arguments(const std::pmr::vector<VarDefinition*>& root){
+	std::vector<std::pair<symbol, std::shared_ptr<Variable>>> args;
 	for(int i = 0; i < root.size(); i++){
 		auto name = root[i]->name;
 		args.push_back(std::make_pair(name, std::make_shared<Variable>(get_type(root[i]->type))));
@@ -35,12 +69,117 @@ std::vector<std::pair<std::string, std::shared_ptr<Variable>>> Executor::get_arg
 	return args;
 }
 
+namespace {
+
+bool is_main(statement decl){
+    auto func = dynamic_cast<FuncDeclStatement*>(decl);
+    return func && func->func->funcName == symbols::main;
+}
+
+bool is_main(const FlatNode& decl){
+    return decl.kind == NodeKind::FUNC_DEF && decl.a == symbols::main;
+}
+
+}
+
 void Executor::execute(const std::vector<statement>& root){
+    finish(root, initialize(root));
+}
+
+std::size_t Executor::initialize(const std::vector<statement>& root){
     scope_control.enterScope();
-    for(int i = 0; i < root.size(); i++){
+    global = scope_control.scopes.top();
+    std::size_t i = 0;
+    for(; i < root.size() && !is_main(root[i]); i++){
+        root[i]->accept(*this);
+        if(auto decl = dynamic_cast<VarDeclStatement*>(root[i])){
+            globals.push_back(decl->var->name);
+        }
+    }
+    return i;
+}
+
+//инициализаторы не вычисляются: функции регистрируются заново, переменные берутся из снимка
+std::optional<std::size_t> Executor::restore(const std::vector<statement>& root, const Snapshot& snapshot){
+    std::size_t declared = 0;
+    for(std::size_t i = 0; i < root.size() && !is_main(root[i]); i++){
+        if(auto decl = dynamic_cast<VarDeclStatement*>(root[i])){
+            if(declared == snapshot.globals.size() || snapshot.globals[declared].name != decl->var->name
+               || snapshot.globals[declared].type != get_type(decl->var->type)){
+                return std::nullopt;
+            }
+            declared++;
+        }
+    }
+    if(declared != snapshot.globals.size()){
+        return std::nullopt;
+    }
+    scope_control.enterScope();
+    global = scope_control.scopes.top();
+    std::size_t i = 0;
+    for(; i < root.size() && !is_main(root[i]); i++){
+        if(dynamic_cast<FuncDeclStatement*>(root[i])){
+            root[i]->accept(*this);
+        }
+    }
+    adopt(snapshot);
+    return i;
+}
+
+void Executor::finish(const std::vector<statement>& root, std::size_t from){
+    for(auto i = from; i < root.size(); i++){
         root[i]->accept(*this);
     }
     scope_control.exitScope();
+    if(auto error = unjoined_error()){
+        std::rethrow_exception(error);
+    }
+}
+
+void Executor::open_session(){
+    scope_control.enterScope();
+    global = scope_control.scopes.top();
+}
+
+void Executor::execute_entry(const std::vector<statement>& entry){
+    auto depth = scope_control.scopes.size();
+    try{
+        for(auto item : entry){
+            item->accept(*this);
+        }
+    }
+    catch(...){
+        while(scope_control.scopes.size() > depth){
+            scope_control.exitScope();
+        }
+        return_flag = continue_flag = break_flag = false;
+        for(auto item : entry){
+            if(auto var = dynamic_cast<VarDeclStatement*>(item)){
+                scope_control.scopes.top()->delete_symbol(var->var->name);
+            }
+            else if(auto func = dynamic_cast<FuncDeclStatement*>(item)){
+                scope_control.scopes.top()->delete_symbol(func->func->funcName);
+            }
+        }
+        throw;
+    }
+}
+
+Snapshot Executor::capture(){
+    Snapshot snapshot;
+    auto& scope = scope_control.scopes.top();
+    for(auto name : globals){
+        auto global = std::dynamic_pointer_cast<Variable>(scope->get_symbol(name));
+        snapshot.globals.push_back({name, global->type, *global->value});
+    }
+    return snapshot;
+}
+
+void Executor::adopt(const Snapshot& snapshot){
+    for(auto& global : snapshot.globals){
+        scope_control.scopes.top()->executorAdd(global.name, std::make_shared<Variable>(global.type, std::make_shared<variable>(global.value)));
+        globals.push_back(global.name);
+    }
 }
 
 void Executor::visit(BinaryNode& root){
@@ -86,19 +225,29 @@ void Executor::visit(PrefixNode& root){
 }
 
 void Executor::visit(FunctionNode& root){
+	if(root.name == symbols::spawn){
+		spawn(root);
+		return;
+	}
+	if(root.name == symbols::join){
+		join(root);
+		return;
+	}
 	scope_control.enterScope();
     if(builtin_funcs.contains(root.name)){
-        if(root.name == "print"){
+        if(root.name == symbols::print){
             for(int i = 0; i < root.branches.size(); i++){
                 root.branches[i]->accept(*this);
-                builtin_funcs.at(root.name)(currRes);
+                builtin_funcs.at(root.name)(*this, currRes);
             }
         }else{
+            read_input = true;
             for(int i = 0; i < root.branches.size(); i++){
                 root.branches[i]->accept(*this);
-                builtin_funcs.at(root.name)(*var);
+                builtin_funcs.at(root.name)(*this, *var);
             }
         }
+        scope_control.exitScope();
         return;
     }
 	if(auto func = std::dynamic_pointer_cast<Function>(scope_control.scopes.top()->get_symbol(root.name)); !func){
@@ -118,6 +267,108 @@ void Executor::visit(FunctionNode& root){
 	scope_control.exitScope();
 }
 
+//аргументы вычисляются сразу; задача исполняется своим исполнителем над копией глобальных,
+//поэтому ничего, кроме потоков ввода-вывода, с породившим её не делит
+void Executor::spawn(FunctionNode& root){
+	auto call = static_cast<FunctionNode*>(root.branches[0]);
+	auto func = std::dynamic_pointer_cast<Function>(scope_control.scopes.top()->get_symbol(call->name));
+	if(!func){
+		throw std::runtime_error("func");
+	}
+	std::vector<variable> args;
+	for(auto arg : call->branches){
+		arg->accept(*this);
+		args.push_back(currRes);
+	}
+	if(tasks == nullptr){
+		tasks = std::make_shared<Tasks>();
+		owns_tasks = true;
+	}
+	auto result = std::make_shared<Tasks::Result>();
+	int handle;
+	{
+		std::lock_guard lock(tasks->mutex);
+		handle = static_cast<int>(tasks->results.size());
+		tasks->results.push_back(result);
+	}
+	tasks->running++;
+	Scheduler::shared().submit([&input = input, &output = output, &names = Interner::current(), tasks = tasks, result, func, args = std::move(args), scope = global->copy()] {
+		{
+			Interner::Use use(names);//задача видит таблицу имён породившего её исполнения
+			Executor task(input, output);
+			task.tasks = tasks;
+			task.global = scope;
+			task.scope_control.scopes.push(scope);
+			try{
+				task.scope_control.enterScope();
+				for(std::size_t i = 0; i < args.size(); i++){
+					auto& [name, param] = func->arguments[i];
+					task.scope_control.scopes.top()->executorAdd(name, std::make_shared<Variable>(param->type, std::make_shared<variable>(args[i])));
+				}
+				func->body->accept(task);
+				result->value = task.currRes;
+			}
+			catch(...){
+				result->error = std::current_exception();
+			}
+		}
+		//после этого корневой исполнитель может закончиться, поэтому исполнитель задачи уже разрушен
+		result->done = true;
+		result->done.notify_all();
+		if(--tasks->running == 0){
+			tasks->running.notify_all();
+		}
+	});
+	currRes = handle;
+}
+
+//дожидается задач корневого исполнителя; первая ошибка задачи, которую никто не ждал через join,
+//возвращается, остальные считаются полученными вместе с ней
+std::exception_ptr Executor::unjoined_error(){
+	if(!owns_tasks){
+		return nullptr;
+	}
+	//вывод задач, которые никто не ждал, тоже попадает в поток; чужие задачи общего пула не ждём
+	for(auto running = tasks->running.load(); running > 0; running = tasks->running.load()){
+		if(!Scheduler::shared().run_one()){
+			tasks->running.wait(running);
+		}
+	}
+	std::exception_ptr first;
+	for(auto& result : tasks->results){
+		if(result->error && !result->observed.exchange(true) && !first){
+			first = result->error;
+		}
+	}
+	return first;
+}
+
+//пока задача не готова, поток исполняет ожидающие задачи пула; когда их нет, а задача идёт в другом потоке, он спит
+void Executor::join(FunctionNode& root){
+	root.branches[0]->accept(*this);
+	auto handle = std::get<int>(currRes);
+	std::shared_ptr<Tasks::Result> result;
+	if(tasks){
+		std::lock_guard lock(tasks->mutex);
+		if(handle >= 0 && static_cast<std::size_t>(handle) < tasks->results.size()){
+			result = tasks->results[handle];
+		}
+	}
+	if(result == nullptr){
+		throw std::runtime_error("Unknown task " + std::to_string(handle));
+	}
+	while(!result->done){
+		if(!Scheduler::shared().run_one()){
+			result->done.wait(false);
+		}
+	}
+	if(result->error){
+		result->observed = true;
+		std::rethrow_exception(result->error);
+	}
+	currRes = result->value;
+}
+
 void Executor::visit(IdentifierNode& root){
     var = scope_control.scopes.top()->get_value(root.name);
     currRes = *var;
@@ -146,10 +397,10 @@ void Executor::visit(ParenthesizedNode& root){
 void Executor::visit(FuncDefinition& root){
     auto type = get_type(root.returnType);
     auto args = get_arguments(root.argsList);
-    if(auto block_statement = std::dynamic_pointer_cast<BlockStatement>(root.commandsList)){
+    if(auto block_statement = dynamic_cast<BlockStatement*>(root.commandsList)){
         scope_control.scopes.top()->executorAdd(root.funcName, std::make_shared<Function>(type, args, block_statement));
     }
-    if(root.funcName == "main"){
+    if(root.funcName == symbols::main){
         scope_control.enterScope();
         root.commandsList->accept(*this);
         scope_control.exitScope();
@@ -198,10 +449,22 @@ void Executor::visit(WhileLoopStatement& root){
             break_flag = false;
             break;
         }
+        if(auto trace = hot_trace(root); trace && trace->enter(scope_control.scopes.top()) == Trace::Exit::LOOP){
+            currRes = false;
+            break;
+        }
         root.condition->accept(*this);
     }
 }
 
+std::shared_ptr<Trace> Executor::hot_trace(WhileLoopStatement& root){
+    auto& trace = traces[&root];
+    if(trace == nullptr){
+        trace = std::make_shared<Trace>(root, [this](variable& value) { builtin_funcs.at(symbols::print)(*this, value); });
+    }
+    return trace->hot() ? trace : nullptr;
+}
+
 void Executor::visit(JumpStatement& root){
     if(root.jumpName == "return"){
         if(root.instructions){
@@ -359,12 +622,256 @@ const std::unordered_map<std::string, std::function<variable(variable, variable)
 	}}
 };
 
-const std::unordered_map<std::string, std::function<void(variable&)>> Executor::builtin_funcs = {
-	{"print", [](variable& arg) {
-		std::visit([](auto&& arg) { std::cout << arg <<std::endl; }, arg);
+const std::unordered_map<symbol, std::function<void(Executor&, variable&)>> Executor::builtin_funcs = {
+	{symbols::print, [](Executor& self, variable& arg) {
+		std::unique_lock<std::mutex> lock;
+		if(self.tasks){
+			lock = std::unique_lock(self.tasks->io);
+		}
+		std::visit([&](auto&& arg) { self.output << arg <<std::endl; }, arg);
 	}},
-	{"scan", [](variable& arg) {
-		std::visit([](auto&& arg) { std::cin >> arg; }, arg);
+	{symbols::scan, [](Executor& self, variable& arg) {
+		std::unique_lock<std::mutex> lock;
+		if(self.tasks){
+			lock = std::unique_lock(self.tasks->io);
+		}
+		std::visit([&](auto&& arg) { self.input >> arg; }, arg);
 	}}
 };
 
+
+/////////////////////////////////////////////////////плоское AST
+namespace {
+
+//таблицы операций Executor, разложенные по Op для прямой индексации
+template<class Table>
+auto by_op(const Table& table) {
+	std::array<const typename Table::mapped_type*, static_cast<std::size_t>(Op::COUNT)> operations{};
+	for(std::size_t i = 0; i < operations.size(); i++){
+		if(auto found = table.find(std::string(FlatAst::spelling(static_cast<Op>(i)))); found != table.end()){
+			operations[i] = &found->second;
+		}
+	}
+	return operations;
+}
+
+template<class Operations>
+auto& operation(const Operations& operations, Op op) {
+	if(auto found = operations[static_cast<std::size_t>(op)]){
+		return *found;
+	}
+	throw std::runtime_error("Unknown operator " + std::string(FlatAst::spelling(op)));
+}
+
+}
+
+void Executor::execute(const FlatAst& ast){
+    finish(ast, initialize(ast));
+}
+
+std::size_t Executor::initialize(const FlatAst& ast){
+    scope_control.enterScope();
+    std::size_t i = 0;
+    for(; i < ast.roots.size() && !is_main(ast[ast.roots[i]]); i++){
+        run(ast, ast.roots[i]);
+        if(ast[ast.roots[i]].kind == NodeKind::VAR_DEF){
+            globals.push_back(ast[ast.roots[i]].a);
+        }
+    }
+    return i;
+}
+
+std::optional<std::size_t> Executor::restore(const FlatAst& ast, const Snapshot& snapshot){
+    std::size_t declared = 0;
+    for(std::size_t i = 0; i < ast.roots.size() && !is_main(ast[ast.roots[i]]); i++){
+        auto& node = ast[ast.roots[i]];
+        if(node.kind == NodeKind::VAR_DEF){
+            if(declared == snapshot.globals.size() || snapshot.globals[declared].name != node.a || snapshot.globals[declared].type != node.type){
+                return std::nullopt;
+            }
+            declared++;
+        }
+    }
+    if(declared != snapshot.globals.size()){
+        return std::nullopt;
+    }
+    scope_control.enterScope();
+    std::size_t i = 0;
+    for(; i < ast.roots.size() && !is_main(ast[ast.roots[i]]); i++){
+        if(ast[ast.roots[i]].kind == NodeKind::FUNC_DEF){
+            run(ast, ast.roots[i]);
+        }
+    }
+    adopt(snapshot);
+    return i;
+}
+
+void Executor::finish(const FlatAst& ast, std::size_t from){
+    for(auto i = from; i < ast.roots.size(); i++){
+        run(ast, ast.roots[i]);
+    }
+    scope_control.exitScope();
+}
+
+void Executor::run(const FlatAst& ast, node_id id){
+	static const auto binary = by_op(binary_operations);
+	static const auto assignment = by_op(assignment_operations);
+	static const auto unary = by_op(unary_operations);
+
+	auto& root = ast[id];
+	switch(root.kind){
+		case NodeKind::BINARY: {
+			run(ast, root.a);
+			auto lhs = currRes;
+			auto tmp = var;
+			run(ast, root.b);
+			if(root.op >= Op::ASSIGN && root.op <= Op::DIV_ASSIGN){
+				*tmp = operation(assignment, root.op)(lhs, currRes);
+			}else{
+				currRes = operation(binary, root.op)(lhs, currRes);
+			}
+			break;
+		}
+		case NodeKind::UNARY:
+			run(ast, root.a);
+			currRes = operation(unary, root.op)(currRes);
+			break;
+		case NodeKind::POSTFIX:
+		case NodeKind::PREFIX:
+			run(ast, root.a);
+			if(root.op == Op::INCREMENT || root.op == Op::DECREMENT){
+				*var = operation(unary, root.op)(currRes);
+				currRes = *var;
+			}else{
+				currRes = operation(unary, root.op)(currRes);
+			}
+			break;
+		case NodeKind::CALL:
+			call(ast, root);
+			break;
+		case NodeKind::IDENTIFIER:
+			var = scope_control.scopes.top()->get_value(root.a);
+			currRes = *var;
+			break;
+		case NodeKind::INT:
+			currRes = ast.integer(id);
+			break;
+		case NodeKind::DOUBLE:
+			currRes = ast.number(id);
+			break;
+		case NodeKind::CHAR:
+			currRes = static_cast<char>(root.a);
+			break;
+		case NodeKind::BOOL:
+			currRes = static_cast<bool>(root.a);
+			break;
+		case NodeKind::PARENTHESIZED:
+		case NodeKind::EXPR:
+			run(ast, root.a);
+			break;
+		case NodeKind::FUNC_DEF: {
+			auto type = root.type;
+			std::vector<std::pair<symbol, std::shared_ptr<Variable>>> args;
+			for(auto param : ast.list(root.c)){
+				args.emplace_back(ast[param].a, std::make_shared<Variable>(ast[param].type));
+			}
+			if(root.b != no_node && ast[root.b].kind == NodeKind::BLOCK){
+				auto func = std::make_shared<Function>(type, args, nullptr);
+				func->node = root.b;
+				scope_control.scopes.top()->executorAdd(root.a, func);
+			}
+			if(root.a == symbols::main){
+				scope_control.enterScope();
+				run(ast, root.b);
+				scope_control.exitScope();
+			}
+			break;
+		}
+		case NodeKind::VAR_DEF:
+			if(root.b != no_node){
+				run(ast, root.b);
+			}else{
+				currRes = default_value(root.type);
+			}
+			scope_control.scopes.top()->executorAdd(root.a, std::make_shared<Variable>(root.type, std::make_shared<variable>(currRes)));
+			break;
+		case NodeKind::COND:
+			run(ast, root.a);
+			if(std::get<bool>(currRes)){
+				scope_control.enterScope();
+				if(root.b != no_node){
+					run(ast, root.b);
+				}
+				scope_control.exitScope();
+			}else if(root.c != no_node){
+				run(ast, root.c);
+			}
+			break;
+		case NodeKind::WHILE:
+			run(ast, root.a);
+			while(std::get<bool>(currRes)){
+				scope_control.enterScope();
+				if(root.b != no_node){
+					run(ast, root.b);
+				}
+				scope_control.exitScope();
+				if(return_flag){
+					break;
+				}else if(continue_flag){
+					continue_flag = false;
+					continue;
+				}else if(break_flag){
+					break_flag = false;
+					break;
+				}
+				run(ast, root.a);
+			}
+			break;
+		case NodeKind::JUMP:
+			if(root.op == Op::RETURN){
+				if(root.a != no_node){
+					run(ast, root.a);
+				}
+				return_flag = true;
+			}else if(root.op == Op::CONTINUE){
+				continue_flag = true;
+			}else{
+				break_flag = true;
+			}
+			break;
+		case NodeKind::BLOCK:
+			for(auto instruction : ast.list(root.c)){
+				run(ast, instruction);
+				if(return_flag || continue_flag || break_flag){
+					break;
+				}
+			}
+			break;
+	}
+}
+
+void Executor::call(const FlatAst& ast, const FlatNode& root){
+	scope_control.enterScope();
+	auto args = ast.list(root.c);
+	if(auto builtin = builtin_funcs.find(root.a); builtin != builtin_funcs.end()){
+		read_input = read_input || root.a == symbols::scan;
+		for(auto arg : args){
+			run(ast, arg);
+			builtin->second(*this, root.a == symbols::print ? currRes : *var);
+		}
+		scope_control.exitScope();
+		return;
+	}
+	auto func = std::dynamic_pointer_cast<Function>(scope_control.scopes.top()->get_symbol(root.a));
+	if(!func){
+		throw std::runtime_error("func");
+	}
+	for(std::size_t i = 0; i != args.size(); i++){
+		run(ast, args[i]);
+		auto value = std::make_shared<variable>(currRes);
+		scope_control.scopes.top()->executorAdd(func->arguments[i].first, std::make_shared<Variable>(func->arguments[i].second->type, value));
+	}
+	run(ast, func->node);
+	return_flag = false;
+	scope_control.exitScope();
+}
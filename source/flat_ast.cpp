@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <unistd.h>
+
+#include "flat_ast.hpp"
+#include "mapped_file.hpp"
+#include "visitor.hpp"
+
+namespace {
+
+constexpr std::string_view op_spellings[] = {
+    "", "+", "-", "*", "/", "==", "!=", ">", ">=", "<", "<=", "||", "&&", "^",
+    "=", "+=", "-=", "*=", "/=",
+    "++", "--", "-", "+", "!",
+    "return", "break", "continue"
+};
+
+static_assert(std::size(op_spellings) == static_cast<std::size_t>(Op::COUNT));
+
+struct Storage {
+    std::vector<FlatNode> nodes;
+    std::vector<double> doubles;
+    std::vector<node_id> lists;
+    std::vector<node_id> roots;
+};
+
+//заголовок файла кэша; массивы идут за ним в порядке полей, каждый с границы 8 байт
+struct FileHeader {
+    char magic[8];
+    std::uint64_t key;
+    std::uint32_t version, nodes, doubles, lists, roots, symbols, names;
+};
+
+constexpr char file_magic[8] = {'F', 'L', 'A', 'T', 'A', 'S', 'T', '1'};
+//увеличивается с любым изменением FlatNode, NodeKind, Op или смысла узлов, включая то, что пропускает анализатор
+constexpr std::uint32_t format_version = 2;
+
+constexpr std::size_t aligned(std::size_t size) {
+    return (size + 7) & ~std::size_t(7);
+}
+
+//файл кэша - внешние данные: ссылки узлов ведут только вперёд и внутрь своих массивов,
+//иначе обход вышел бы за границы или зациклился; исполнитель и анализатор без проверок полагаются
+//и на виды детей: тело функции - блок, аргументы scan - имена, число аргументов вызова - число параметров
+bool valid(const FlatAst& ast, std::uint32_t symbols) {
+    auto size = ast.nodes.size();
+    auto child = [&](node_id parent, node_id id, bool optional) {
+        return id == no_node ? optional : id > parent && id < size;
+    };
+    auto list = [&](node_id parent, std::uint32_t offset) {
+        if(offset >= ast.lists.size() || ast.lists[offset] >= ast.lists.size() - offset){
+            return false;
+        }
+        for(auto id : ast.list(offset)){
+            if(!child(parent, id, false)){
+                return false;
+            }
+        }
+        return true;
+    };
+    for(node_id id = 0; id < size; id++){
+        auto& node = ast.nodes[id];
+        if(node.op >= Op::COUNT || node.type > Type::BOOL){
+            return false;
+        }
+        bool ok = false;
+        switch(node.kind){
+            case NodeKind::BINARY:
+                ok = child(id, node.a, false) && child(id, node.b, false);
+                break;
+            case NodeKind::UNARY:
+            case NodeKind::POSTFIX:
+            case NodeKind::PREFIX:
+            case NodeKind::PARENTHESIZED:
+            case NodeKind::EXPR:
+                ok = child(id, node.a, false);
+                break;
+            case NodeKind::CALL:
+                ok = node.a < symbols && list(id, node.c);
+                break;
+            case NodeKind::IDENTIFIER:
+                ok = node.a < symbols;
+                break;
+            case NodeKind::INT:
+            case NodeKind::CHAR:
+            case NodeKind::BOOL:
+                ok = true;
+                break;
+            case NodeKind::DOUBLE:
+                ok = node.a < ast.doubles.size();
+                break;
+            case NodeKind::VAR_DEF:
+                ok = node.a < symbols && child(id, node.b, true);
+                break;
+            case NodeKind::FUNC_DEF:
+                ok = node.a < symbols && child(id, node.b, true) && list(id, node.c)
+                  && (node.b == no_node || ast.nodes[node.b].kind == NodeKind::BLOCK)
+                  && std::ranges::all_of(ast.list(node.c), [&](node_id param) { return ast.nodes[param].kind == NodeKind::VAR_DEF; });
+                break;
+            case NodeKind::COND:
+                ok = child(id, node.a, false) && child(id, node.b, false) && child(id, node.c, true);
+                break;
+            case NodeKind::WHILE:
+                ok = child(id, node.a, false) && child(id, node.b, false);
+                break;
+            case NodeKind::JUMP:
+                ok = child(id, node.a, true);
+                break;
+            case NodeKind::BLOCK:
+                ok = list(id, node.c);
+                break;
+        }
+        if(!ok){
+            return false;
+        }
+    }
+    std::unordered_map<symbol, std::size_t> params;
+    for(auto root : ast.roots){
+        if(root >= size){
+            return false;
+        }
+        if(ast.nodes[root].kind == NodeKind::FUNC_DEF && !params.try_emplace(ast.nodes[root].a, ast.list(ast.nodes[root].c).size()).second){
+            return false;
+        }
+    }
+    for(auto& node : ast.nodes){
+        if(node.kind != NodeKind::CALL){
+            continue;
+        }
+        auto args = ast.list(node.c);
+        if(node.a == symbols::scan){
+            if(!std::ranges::all_of(args, [&](node_id arg) { return ast.nodes[arg].kind == NodeKind::IDENTIFIER; })){
+                return false;
+            }
+        }
+        else if(node.a != symbols::print){
+            auto callee = params.find(node.a);
+            if(callee == params.end() || callee->second != args.size()){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+Op binary_op(std::string_view op) {
+    for(std::size_t i = static_cast<std::size_t>(Op::ADD); i <= static_cast<std::size_t>(Op::DIV_ASSIGN); i++){
+        if(op_spellings[i] == op){
+            return static_cast<Op>(i);
+        }
+    }
+    throw std::runtime_error("Unknown binary operator " + std::string(op));
+}
+
+Op unary_op(std::string_view op) {
+    if(op == "++") return Op::INCREMENT;
+    if(op == "--") return Op::DECREMENT;
+    if(op == "-") return Op::MINUS;
+    if(op == "+") return Op::PLUS;
+    if(op == "!") return Op::NOT;
+    throw std::runtime_error("Unknown unary operator " + std::string(op));
+}
+
+//переводит дерево указателей в плоское: родитель занимает слот раньше детей
+class FlatBuilder : public Visitor {
+public:
+    FlatBuilder(Storage& ast) : ast(ast) {}
+
+    node_id build(ASTNode* root) {
+        if(root == nullptr){
+            return no_node;
+        }
+        root->accept(*this);
+        return result;
+    }
+
+    template<class Range>
+    std::uint32_t list(const Range& items) {
+        std::vector<node_id> ids;
+        ids.reserve(items.size());
+        for(auto item : items){
+            ids.push_back(build(item));
+        }
+        auto offset = static_cast<std::uint32_t>(ast.lists.size());
+        ast.lists.push_back(static_cast<node_id>(ids.size()));
+        ast.lists.insert(ast.lists.end(), ids.begin(), ids.end());
+        return offset;
+    }
+
+    void visit(BinaryNode& root) {
+        auto id = add({NodeKind::BINARY, binary_op(root.op)});
+        auto lhs = build(root.left_branch);
+        auto rhs = build(root.right_branch);
+        ast.nodes[id].a = lhs;
+        ast.nodes[id].b = rhs;
+        result = id;
+    }
+
+    void visit(UnaryNode& root) { operand(NodeKind::UNARY, root.op, root.branch); }
+    void visit(PostfixNode& root) { operand(NodeKind::POSTFIX, root.op, root.branch); }
+    void visit(PrefixNode& root) { operand(NodeKind::PREFIX, root.op, root.branch); }
+
+    void visit(FunctionNode& root) {
+        if(root.name == symbols::spawn || root.name == symbols::join){
+            throw std::runtime_error("Tasks have no flat form");
+        }
+        auto id = add({NodeKind::CALL, Op::NONE, Type::VOID, false, root.name});
+        auto args = list(root.branches);
+        ast.nodes[id].c = args;
+        result = id;
+    }
+
+    void visit(IdentifierNode& root) { result = add({NodeKind::IDENTIFIER, Op::NONE, Type::VOID, false, root.name}); }
+    void visit(IntNode& root) { result = add({NodeKind::INT, Op::NONE, Type::INT, false, std::bit_cast<std::uint32_t>(root.value)}); }
+    void visit(CharNode& root) { result = add({NodeKind::CHAR, Op::NONE, Type::CHAR, false, static_cast<std::uint32_t>(root.value)}); }
+    void visit(BoolNode& root) { result = add({NodeKind::BOOL, Op::NONE, Type::BOOL, false, root.value}); }
+
+    void visit(DoubleNode& root) {
+        result = add({NodeKind::DOUBLE, Op::NONE, Type::DOUBLE, false, static_cast<std::uint32_t>(ast.doubles.size())});
+        ast.doubles.push_back(root.value);
+    }
+
+    void visit(ParenthesizedNode& root) {
+        auto id = add({NodeKind::PARENTHESIZED});
+        ast.nodes[id].a = build(root.expression);
+        result = id;
+    }
+
+    void visit(VarDefinition& root) {
+        auto id = add({NodeKind::VAR_DEF, Op::NONE, Executor::get_type(root.type), root.const_specifier, root.name});
+        ast.nodes[id].b = build(root.value);
+        result = id;
+    }
+
+    void visit(FuncDefinition& root) {
+        auto id = add({NodeKind::FUNC_DEF, Op::NONE, Executor::get_type(root.returnType), false, root.funcName});
+        auto params = list(root.argsList);
+        auto body = build(root.commandsList);
+        ast.nodes[id].b = body;
+        ast.nodes[id].c = params;
+        result = id;
+    }
+
+    void visit(ExprStatement& root) {
+        auto id = add({NodeKind::EXPR});
+        ast.nodes[id].a = build(root.expression);
+        result = id;
+    }
+
+    void visit(CondStatement& root) {
+        auto id = add({NodeKind::COND});
+        auto condition = build(root.condition);
+        auto if_instruction = build(root.if_instruction);
+        auto else_instruction = build(root.else_instruction);
+        ast.nodes[id].a = condition;
+        ast.nodes[id].b = if_instruction;
+        ast.nodes[id].c = else_instruction;
+        result = id;
+    }
+
+    void visit(ForLoopStatement&) {
+        throw std::runtime_error("For loop has no flat form");
+    }
+
+    void visit(WhileLoopStatement& root) {
+        auto id = add({NodeKind::WHILE});
+        auto condition = build(root.condition);
+        auto body = build(root.instructions);
+        ast.nodes[id].a = condition;
+        ast.nodes[id].b = body;
+        result = id;
+    }
+
+    void visit(JumpStatement& root) {
+        auto id = add({NodeKind::JUMP, root.jumpName == "return" ? Op::RETURN : root.jumpName == "break" ? Op::BREAK : Op::CONTINUE});
+        ast.nodes[id].a = build(root.instructions);
+        result = id;
+    }
+
+    void visit(BlockStatement& root) {
+        auto id = add({NodeKind::BLOCK});
+        auto instructions = list(root.instructions);
+        ast.nodes[id].c = instructions;
+        result = id;
+    }
+
+    void visit(VarDeclStatement& root) { result = build(root.var); }
+    void visit(FuncDeclStatement& root) { result = build(root.func); }
+private:
+    node_id add(FlatNode node) {
+        ast.nodes.push_back(node);
+        return static_cast<node_id>(ast.nodes.size() - 1);
+    }
+
+    void operand(NodeKind kind, const std::string& op, expr branch) {
+        auto id = add({kind, unary_op(op)});
+        ast.nodes[id].a = build(branch);
+        result = id;
+    }
+
+    Storage& ast;
+    node_id result = no_node;
+};
+
+}
+
+FlatAst FlatAst::build(const std::vector<statement>& root) {
+    auto storage = std::make_shared<Storage>();
+    FlatBuilder builder(*storage);
+    for(auto decl : root){
+        storage->roots.push_back(builder.build(decl));
+    }
+    FlatAst ast;
+    ast.nodes = storage->nodes;
+    ast.doubles = storage->doubles;
+    ast.lists = storage->lists;
+    ast.roots = storage->roots;
+    ast.storage = std::move(storage);
+    return ast;
+}
+
+void FlatAst::save(const std::string& path, std::uint64_t key) const {
+    auto symbols = Interner::current().size();
+    std::string names;
+    for(symbol id = 0; id < symbols; id++){
+        names += ::spelling(id);
+        names += '\0';
+    }
+    FileHeader header{};
+    std::memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.key = key;
+    header.version = format_version;
+    header.nodes = static_cast<std::uint32_t>(nodes.size());
+    header.doubles = static_cast<std::uint32_t>(doubles.size());
+    header.lists = static_cast<std::uint32_t>(lists.size());
+    header.roots = static_cast<std::uint32_t>(roots.size());
+    header.symbols = static_cast<std::uint32_t>(symbols);
+    header.names = static_cast<std::uint32_t>(names.size());
+
+    auto temp = path + "." + std::to_string(getpid());
+    {
+        std::ofstream out(temp, std::ios::binary);
+        auto write = [&](const void* data, std::size_t size) {
+            static constexpr char padding[8] = {};
+            out.write(static_cast<const char*>(data), size);
+            out.write(padding, aligned(size) - size);
+        };
+        write(&header, sizeof(header));
+        write(nodes.data(), nodes.size_bytes());
+        write(doubles.data(), doubles.size_bytes());
+        write(lists.data(), lists.size_bytes());
+        write(roots.data(), roots.size_bytes());
+        write(names.data(), names.size());
+        if(!out){
+            throw std::runtime_error("Can't write " + temp);
+        }
+    }
+    std::filesystem::rename(temp, path);//атомарно для параллельных запусков
+}
+
+std::optional<FlatAst> FlatAst::load(const std::string& path, std::uint64_t key) {
+    if(!std::filesystem::exists(path)){
+        return std::nullopt;
+    }
+    auto file = std::make_shared<MappedFile>(path);
+    auto text = file->text();
+    FileHeader header;
+    if(text.size() < sizeof(header)){
+        return std::nullopt;
+    }
+    std::memcpy(&header, text.data(), sizeof(header));
+    if(std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0 || header.version != format_version || header.key != key){
+        return std::nullopt;
+    }
+    std::size_t offset = aligned(sizeof(header));
+    auto section = [&]<class T>(std::span<const T>& view, std::size_t count) {
+        view = {reinterpret_cast<const T*>(text.data() + offset), count};
+        offset += aligned(count * sizeof(T));
+    };
+    auto sizes = aligned(sizeof(header)) + aligned(header.nodes * sizeof(FlatNode)) + aligned(header.doubles * sizeof(double))
+               + aligned(header.lists * sizeof(node_id)) + aligned(header.roots * sizeof(node_id)) + header.names;
+    if(text.size() < sizes){
+        return std::nullopt;
+    }
+    FlatAst ast;
+    section(ast.nodes, header.nodes);
+    section(ast.doubles, header.doubles);
+    section(ast.lists, header.lists);
+    section(ast.roots, header.roots);
+
+    //в узлах номера символов сохранившего процесса; подходят, только если здесь те же имена получают те же номера
+    auto names = text.substr(offset, header.names);
+    for(symbol id = 0; id < header.symbols; id++){
+        auto end = names.find('\0');
+        if(end == std::string_view::npos || Interner::current().intern(names.substr(0, end)) != id){
+            return std::nullopt;
+        }
+        names.remove_prefix(end + 1);
+    }
+    if(!valid(ast, header.symbols)){
+        return std::nullopt;
+    }
+    ast.storage = std::move(file);
+    return ast;
+}
+
+std::uint32_t FlatAst::version() {
+    return format_version;
+}
+
+std::string_view FlatAst::spelling(Op op) {
+    return op_spellings[static_cast<std::size_t>(op)];
+}
+
+std::string_view FlatAst::spelling(Type type) {
+    switch(type){
+        case Type::INT: return "int";
+        case Type::DOUBLE: return "double";
+        case Type::CHAR: return "char";
+        case Type::BOOL: return "bool";
+        default: return "void";
+    }
+}
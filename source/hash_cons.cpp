@@ -0,0 +1,107 @@
+#include <bit>
+#include <string>
+
+#include "hash_cons.hpp"
+
+namespace {
+
+//операторы не длиннее двух символов укладываются в 16 бит
+std::uint16_t op_code(std::string_view op) {
+    return static_cast<std::uint16_t>(static_cast<unsigned char>(op[0]) | (op.size() > 1 ? static_cast<unsigned char>(op[1]) << 8 : 0));
+}
+
+}
+
+HashCons::Stats& HashCons::Stats::operator+=(const Stats& other) {
+    unique += other.unique;
+    shared += other.shared;
+    saved += other.saved;
+    return *this;
+}
+
+std::size_t HashCons::KeyHash::operator()(const Key& key) const {
+    auto mix = [](std::uint64_t hash, std::uint64_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        return hash;
+    };
+    auto hash = mix(static_cast<std::uint64_t>(key.shape) << 16 | key.op, key.payload);
+    hash = mix(hash, reinterpret_cast<std::uintptr_t>(key.left));
+    return mix(hash, reinterpret_cast<std::uintptr_t>(key.right));
+}
+
+HashCons::HashCons(Arena& arena, bool enabled) : arena(arena), enabled(enabled) {}
+
+template<class T, class... Args>
+expr HashCons::intern(const Key& key, Args&&... args) {
+    auto [it, inserted] = table.try_emplace(key, nullptr);
+    if(!inserted){
+        counters.shared++;
+        counters.saved += Arena::footprint<T>();
+        return it->second;
+    }
+    it->second = arena.make<T>(std::forward<Args>(args)...);
+    canonical.insert(it->second);
+    counters.unique++;
+    return it->second;
+}
+
+bool HashCons::pure(expr node) const {
+    return canonical.contains(node);
+}
+
+expr HashCons::integer(int value) {
+    if(!enabled){
+        return arena.make<IntNode>(value);
+    }
+    return intern<IntNode>({static_cast<std::uint32_t>(value), nullptr, nullptr, 0, Shape::INT}, value);
+}
+
+expr HashCons::number(double value) {
+    if(!enabled){
+        return arena.make<DoubleNode>(value);
+    }
+    //по битам: 0.0 и -0.0 остаются разными константами
+    return intern<DoubleNode>({std::bit_cast<std::uint64_t>(value), nullptr, nullptr, 0, Shape::DOUBLE}, value);
+}
+
+expr HashCons::character(char value) {
+    if(!enabled){
+        return arena.make<CharNode>(std::string(1, value));
+    }
+    return intern<CharNode>({static_cast<unsigned char>(value), nullptr, nullptr, 0, Shape::CHAR}, std::string(1, value));
+}
+
+expr HashCons::boolean(bool value) {
+    if(!enabled){
+        return arena.make<BoolNode>(value);
+    }
+    return intern<BoolNode>({value, nullptr, nullptr, 0, Shape::BOOL}, value);
+}
+
+expr HashCons::identifier(symbol name) {
+    if(!enabled){
+        return arena.make<IdentifierNode>(name);
+    }
+    return intern<IdentifierNode>({name, nullptr, nullptr, 0, Shape::IDENTIFIER}, name);
+}
+
+expr HashCons::unary(std::string_view op, expr branch) {
+    if(!enabled || !pure(branch)){
+        return arena.make<UnaryNode>(std::string(op), branch);
+    }
+    return intern<UnaryNode>({0, branch, nullptr, op_code(op), Shape::UNARY}, std::string(op), branch);
+}
+
+expr HashCons::parenthesized(expr expression) {
+    if(!enabled || !pure(expression)){
+        return arena.make<ParenthesizedNode>(expression);
+    }
+    return intern<ParenthesizedNode>({0, expression, nullptr, 0, Shape::PARENTHESIZED}, expression);
+}
+
+expr HashCons::binary(std::string_view op, expr lhs, expr rhs, bool pure_op) {
+    if(!enabled || !pure_op || !pure(lhs) || !pure(rhs)){
+        return arena.make<BinaryNode>(std::string(op), lhs, rhs);
+    }
+    return intern<BinaryNode>({0, lhs, rhs, op_code(op), Shape::BINARY}, std::string(op), lhs, rhs);
+}
@@ -0,0 +1,98 @@
+#include <array>
+#include <iostream>
+#include <stdexcept>
+
+#include "interpreter.hpp"
+#include "module.hpp"
+#include "parser.hpp"
+#include "visitor.hpp"
+
+namespace {
+
+class InputBuffer : public std::streambuf {
+public:
+    explicit InputBuffer(const std::function<std::size_t(char*, std::size_t)>& read) : read(read) {}
+protected:
+    int_type underflow() override {
+        auto size = read(buffer.data(), buffer.size());
+        if(size == 0){
+            return traits_type::eof();
+        }
+        setg(buffer.data(), buffer.data(), buffer.data() + size);
+        return traits_type::to_int_type(buffer.front());
+    }
+private:
+    const std::function<std::size_t(char*, std::size_t)>& read;
+    std::array<char, 4096> buffer;
+};
+
+class OutputBuffer : public std::streambuf {
+public:
+    explicit OutputBuffer(const std::function<void(std::string_view)>& write) : write(write) {
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+protected:
+    int_type overflow(int_type c) override {
+        flush();
+        if(!traits_type::eq_int_type(c, traits_type::eof())){
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        flush();
+        return 0;
+    }
+private:
+    void flush() {
+        if(pptr() != pbase()){
+            std::string_view chunk(pbase(), pptr() - pbase());
+            setp(buffer.data(), buffer.data() + buffer.size());
+            write(chunk);
+        }
+    }
+
+    const std::function<void(std::string_view)>& write;
+    std::array<char, 4096> buffer;
+};
+
+}
+
+std::shared_ptr<const Program> Program::compile(std::string source) {
+    if(!read_header(source).imports.empty()){
+        throw std::runtime_error("Embedded programs can't import modules");
+    }
+    std::shared_ptr<Program> program(new Program);
+    program->text = std::move(source);
+    Interner::Use use(program->interner());
+    program->tree = Parser::parse_parallel(program->text, program->arena, 1);
+    Analyzer analyzer;
+    analyzer.analyze_parallel(program->tree, 1);
+    return program;
+}
+
+Context::Context(std::shared_ptr<const Program> program, Io io) : program(std::move(program)), io(std::move(io)) {}
+
+//состояние исполнителя живёт только на время run, поэтому исполнения одной программы друг другу не мешают
+void Context::run() {
+    InputBuffer input_buffer(io.read);
+    OutputBuffer output_buffer(io.write);
+    std::istream input(io.read ? &input_buffer : std::cin.rdbuf());
+    std::ostream output(io.write ? &output_buffer : std::cout.rdbuf());
+    output.exceptions(std::ios::badbit);//исключение из write прерывает исполнение
+    Interner::Use use(program->interner());
+    Executor executor(input, output);
+    try{
+        executor.execute(program->declarations());
+    }
+    catch(...){
+        try{
+            output.flush();
+        }
+        catch(...){}
+        throw;
+    }
+    output.flush();
+}
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "jobs.hpp"
+#include "interpreter.hpp"
+#include "mapped_file.hpp"
+#include "scheduler.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed(Clock::time_point since, double scale = 1) {
+    return std::chrono::duration<double>(Clock::now() - since).count() * scale;
+}
+
+//nearest-rank по отсортированным значениям
+double percentile(const std::vector<double>& sorted, double rank) {
+    if(sorted.empty()){
+        return 0;
+    }
+    auto index = static_cast<std::size_t>(std::ceil(rank / 100 * sorted.size()));
+    return sorted[std::clamp<std::size_t>(index, 1, sorted.size()) - 1];
+}
+
+std::string read_file(const std::string& path) {
+    if(path == "-"){
+        return "";
+    }
+    return std::string(MappedFile(path).text());
+}
+
+}
+
+std::vector<Job> read_manifest(const std::string& path) {
+    std::ifstream in(path);
+    if(!in){
+        throw std::runtime_error("Can't open " + path);
+    }
+    auto directory = std::filesystem::path(path).parent_path();
+    auto resolve = [&](const std::string& name) {
+        return name == "-" ? name : (directory / name).string();
+    };
+    std::vector<Job> jobs;
+    std::string line;
+    for(std::size_t number = 1; std::getline(in, line); number++){
+        std::istringstream words(line);
+        Job job;
+        if(!(words >> job.program)){
+            continue;
+        }
+        std::string extra;
+        if(!(words >> job.input >> job.output) || words >> extra){
+            throw std::runtime_error(path + ":" + std::to_string(number) + ": expected program, input and output");
+        }
+        jobs.push_back({resolve(job.program), resolve(job.input), resolve(job.output)});
+    }
+    return jobs;
+}
+
+JobReport run_jobs(const std::vector<Job>& jobs, std::ostream& errors, unsigned threads) {
+    JobReport report;
+    std::mutex errors_mutex;
+    auto fail = [&](std::size_t index, const std::string& message) {
+        std::lock_guard lock(errors_mutex);
+        errors << "job " << index + 1 << " (" << jobs[index].program << "): " << message << std::endl;
+    };
+
+    //программы по каноническим путям; слоты заполняются до запуска задач, поэтому карта дальше только читается
+    struct Compiled {
+        std::string path;
+        std::shared_ptr<const Program> program;
+        std::string error;
+    };
+    std::unordered_map<std::string, std::size_t> index;
+    std::vector<Compiled> programs;
+    std::vector<std::size_t> program_of(jobs.size());
+    for(std::size_t i = 0; i < jobs.size(); i++){
+        auto key = std::filesystem::weakly_canonical(jobs[i].program).string();
+        auto [it, added] = index.try_emplace(key, programs.size());
+        if(added){
+            programs.push_back({jobs[i].program, nullptr, ""});
+        }
+        program_of[i] = it->second;
+    }
+    report.latencies.resize(jobs.size());
+    std::vector<char> failed(jobs.size(), false);
+
+    //без явного числа потоков задания идут в общий пул, куда попадают и их spawn
+    std::optional<Scheduler> own;
+    auto& scheduler = threads == 0 ? Scheduler::shared() : own.emplace(threads);
+    auto start = Clock::now();
+    for(auto& compiled : programs){
+        scheduler.submit([&compiled] {
+            try{
+                compiled.program = Program::compile(read_file(compiled.path));
+            }
+            catch(const std::exception& error){
+                compiled.error = error.what();
+            }
+        });
+    }
+    scheduler.wait();
+    report.compile_seconds = elapsed(start);
+    report.programs = std::count_if(programs.begin(), programs.end(), [](const Compiled& compiled) { return compiled.program != nullptr; });
+    report.rejected = programs.size() - report.programs;
+
+    for(std::size_t i = 0; i < jobs.size(); i++){
+        scheduler.submit([&, i] {
+            auto begin = Clock::now();
+            try{
+                auto& compiled = programs[program_of[i]];
+                if(compiled.program == nullptr){
+                    throw std::runtime_error(compiled.error);
+                }
+                auto input = read_file(jobs[i].input);
+                std::string_view rest = input;
+                std::string output;
+                Context context(compiled.program, {
+                    [&](char* buffer, std::size_t size) {
+                        auto count = rest.copy(buffer, size);
+                        rest.remove_prefix(count);
+                        return count;
+                    },
+                    [&](std::string_view text) { output += text; }
+                });
+                std::exception_ptr error;
+                try{
+                    context.run();
+                }
+                catch(...){
+                    error = std::current_exception();
+                }
+                //вывод до ошибки тоже сохраняется
+                std::ofstream out(jobs[i].output, std::ios::binary);
+                out << output;
+                if(!out){
+                    throw std::runtime_error("Can't write " + jobs[i].output);
+                }
+                if(error){
+                    std::rethrow_exception(error);
+                }
+            }
+            catch(const std::exception& error){
+                failed[i] = true;
+                fail(i, error.what());
+            }
+            report.latencies[i] = elapsed(begin, 1000);
+        });
+    }
+    scheduler.wait();
+    report.seconds = elapsed(start);
+    report.failed = std::count(failed.begin(), failed.end(), true);
+    return report;
+}
+
+void JobReport::print(std::ostream& out) const {
+    auto sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    out << std::fixed << std::setprecision(3)
+        << "jobs: " << latencies.size() << " run, " << failed << " failed, " << programs << " programs compiled"
+        << (rejected > 0 ? ", " + std::to_string(rejected) + " failed to compile" : "") << " in " << compile_seconds * 1000 << " ms\n"
+        << "total: " << seconds << " s, " << (seconds > 0 ? latencies.size() / seconds : 0) << " jobs/s\n"
+        << "latency ms: p50 " << percentile(sorted, 50) << ", p90 " << percentile(sorted, 90) << ", p99 " << percentile(sorted, 99)
+        << ", max " << (sorted.empty() ? 0 : sorted.back()) << std::endl;
+    out << std::defaultfloat;
+}
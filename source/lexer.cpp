@@ -1,58 +1,239 @@
 #include <string>
 #include <vector>
-#include <unordered_set>
 #include <stdexcept>
-#include <cctype>
+#include <algorithm>
+#include <array>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "lexer.hpp"
 
-Lexer::Lexer(const std::string& input) : input(input), offset(0) {}
-
-std::vector<Token> Lexer::tokenize() {
-	std::vector<Token> tokens;
-	while(input[offset]) {
-		if (std::isblank(input[offset]) || input[offset] == '\n') {
-			offset++;
-		} else if (std::isdigit(input[offset]) || input[offset] == '.') {
-			tokens.push_back(extract_number());
-		} else if (std::isalpha(input[offset]) || input[offset] == '_' || input[offset] == '\'') {
-			tokens.push_back(extract_identifier());
-		} else if (metachars.contains(input[offset])) {
-			tokens.push_back(extract_operator());
-		} else if (input[offset] == '(') {
-			offset++;
-			tokens.push_back(Token{TokenType::LPAREN, "("});
-		} else if (input[offset] == ')') {
-			offset++;
-			tokens.push_back(Token{TokenType::RPAREN, ")"});
-		} else if (input[offset] == '{') {
-			offset++;
-			tokens.push_back(Token{TokenType::LBRACE, "{"});
-		} else if (input[offset] == '}') {
-			offset++;
-			tokens.push_back(Token{TokenType::RBRACE, "}"});
-		} else if (input[offset] == ',') {
-			offset++;
-			tokens.push_back(Token{TokenType::COMMA, ","});
-		} else if (input[offset] == ';') {
-			offset++;
-			tokens.push_back(Token{TokenType::SEMICOLON, ";"});
-		} else {
-			throw std::runtime_error("Unknown symbol" + input[offset]);
+namespace {
+
+//классы символов для таблицы разбора
+enum CharClass : std::uint8_t {
+	OTHER, BLANK, DIGIT, ALPHA, QUOTE, META, LPAREN, RPAREN, LBRACE, RBRACE, COMMA, SEMICOLON, DOT
+};
+
+constexpr std::array<std::uint8_t, 256> make_classes() {
+	std::array<std::uint8_t, 256> table{};
+	table[' '] = table['\t'] = table['\n'] = BLANK;
+	for (int c = '0'; c <= '9'; c++) table[c] = DIGIT;
+	for (int c = 'a'; c <= 'z'; c++) table[c] = ALPHA;
+	for (int c = 'A'; c <= 'Z'; c++) table[c] = ALPHA;
+	table['_'] = ALPHA;
+	table['\''] = QUOTE;
+	for (char c : std::string_view("+-*/^=!<>|&")) table[static_cast<unsigned char>(c)] = META;
+	table['('] = LPAREN;
+	table[')'] = RPAREN;
+	table['{'] = LBRACE;
+	table['}'] = RBRACE;
+	table[','] = COMMA;
+	table[';'] = SEMICOLON;
+	table['.'] = DOT;
+	return table;
+}
+
+constexpr auto classes = make_classes();
+
+constexpr std::uint8_t class_of(char c) {
+	return classes[static_cast<unsigned char>(c)];
+}
+
+constexpr bool word_char(char c) {
+	return class_of(c) == ALPHA || class_of(c) == DIGIT;
+}
+
+//двухсимвольные операторы, остальные операторы - одиночные метасимволы
+constexpr bool is_operator(char first, char second) {
+	switch (first) {
+		case '=': case '!': case '<': case '>': return second == '=';
+		case '+': return second == '=' || second == '+';
+		case '-': return second == '=' || second == '-';
+		case '|': return second == '|';
+		case '&': return second == '&';
+		default: return false;
+	}
+}
+
+struct Word {
+	std::string_view text;
+	TokenType type;
+};
+
+constexpr std::array<Word, 15> words = {{
+	{"if", TokenType::KEYWORD}, {"while", TokenType::KEYWORD}, {"for", TokenType::KEYWORD},
+	{"return", TokenType::KEYWORD}, {"break", TokenType::KEYWORD}, {"continue", TokenType::KEYWORD},
+	{"true", TokenType::BOOL_LITERAL}, {"false", TokenType::BOOL_LITERAL},
+	{"int", TokenType::VARTYPE}, {"char", TokenType::VARTYPE}, {"float", TokenType::VARTYPE},
+	{"double", TokenType::VARTYPE}, {"bool", TokenType::VARTYPE}, {"void", TokenType::VARTYPE},
+	{"const", TokenType::CONST}
+}};
+
+//совершенный хеш ключевых слов и типов: первый и последний символ плюс длина
+constexpr std::size_t word_hash(std::string_view word) {
+	return (static_cast<unsigned char>(word.front()) * 3 + static_cast<unsigned char>(word.back()) * 8 + word.size()) & 31;
+}
+
+constexpr std::array<std::int8_t, 32> make_word_table() {
+	std::array<std::int8_t, 32> table{};
+	table.fill(-1);
+	for (std::size_t i = 0; i < words.size(); i++) {
+		if (table[word_hash(words[i].text)] != -1) {
+			throw "keyword hash collision";
 		}
+		table[word_hash(words[i].text)] = static_cast<std::int8_t>(i);
 	}
-	tokens.push_back(Token{TokenType::END, ""});
-	return tokens;
+	return table;
+}
+
+constexpr auto word_table = make_word_table();
+
+constexpr TokenType classify(std::string_view word) {
+	if (auto index = word_table[word_hash(word)]; index != -1 && words[index].text == word) {
+		return words[index].type;
+	}
+	return TokenType::IDENTIFIER;
+}
+
+static_assert(classify("while") == TokenType::KEYWORD && classify("const") == TokenType::CONST && classify("whilst") == TokenType::IDENTIFIER);
+
+}
+
+Lexer::Lexer(std::string_view input, std::size_t begin) : input(input), offset(begin) {}
+
+TokenStream Lexer::tokenize() {
+	TokenStream tokens;
+	tokens.source = input;
+	for (auto token = next();; token = next()) {
+		tokens.push(token.type, token.value.data() - input.data(), token.value.size(), token.id);
+		if (token.type == TokenType::END) {
+			return tokens;
+		}
+	}
+}
+
+//токены досчитываются в кольцо по мере надобности, память не зависит от размера исходника
+const Token& Lexer::fill(std::size_t k) {
+	if (k >= lookahead) {
+		throw std::runtime_error("Lookahead " + std::to_string(k) + " exceeds lexer ring");
+	}
+	for (; count <= k; count++) {
+		ring[(head + count) % lookahead] = scan();
+	}
+	return ring[(head + k) % lookahead];
+}
+
+std::pair<std::size_t, std::size_t> Lexer::position(const Token& token) const {
+	auto before = input.substr(0, token.value.data() - input.data());
+	auto line_start = before.rfind('\n');
+	return {std::count(before.begin(), before.end(), '\n') + 1, before.size() - (line_start == std::string_view::npos ? 0 : line_start + 1) + 1};
+}
+
+Token Lexer::scan() {
+	while (offset < input.size() && input[offset]) {
+		switch (class_of(input[offset])) {
+			case BLANK:
+				skip_blanks();
+				break;
+			case DIGIT:
+			case DOT:
+				return extract_number();
+			case ALPHA:
+			case QUOTE:
+				return extract_identifier();
+			case META:
+				return extract_operator();
+			case LPAREN:
+				return Token{TokenType::LPAREN, input.substr(offset++, 1)};
+			case RPAREN:
+				return Token{TokenType::RPAREN, input.substr(offset++, 1)};
+			case LBRACE:
+				return Token{TokenType::LBRACE, input.substr(offset++, 1)};
+			case RBRACE:
+				return Token{TokenType::RBRACE, input.substr(offset++, 1)};
+			case COMMA:
+				return Token{TokenType::COMMA, input.substr(offset++, 1)};
+			case SEMICOLON:
+				return Token{TokenType::SEMICOLON, input.substr(offset++, 1)};
+			default:
+				throw std::runtime_error("Unknown symbol " + std::string(1, input[offset]));
+		}
+	}
+	return Token{TokenType::END, input.substr(input.size())};
+}
+
+//пробелы, табуляции и переводы строк пропускаются по 16 байт за шаг
+void Lexer::skip_blanks() {
+#ifdef __SSE2__
+	const auto space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), newline = _mm_set1_epi8('\n');
+	while (offset + 16 <= input.size()) {
+		auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + offset));
+		auto blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)), _mm_cmpeq_epi8(chunk, newline));
+		auto bits = static_cast<unsigned>(_mm_movemask_epi8(blank));
+		if (bits != 0xFFFF) {
+			offset += __builtin_ctz(~bits);
+			return;
+		}
+		offset += 16;
+	}
+#endif
+	while (offset < input.size() && class_of(input[offset]) == BLANK) {
+		offset++;
+	}
+}
+
+//длина серии [A-Za-z0-9_] начиная с позиции
+std::size_t Lexer::word_length(std::size_t position) const {
+	auto start = position;
+#ifdef __SSE2__
+	const auto case_bit = _mm_set1_epi8(0x20);
+	const auto lower_a = _mm_set1_epi8('a' - 1), lower_z = _mm_set1_epi8('z' + 1);
+	const auto digit_0 = _mm_set1_epi8('0' - 1), digit_9 = _mm_set1_epi8('9' + 1);
+	const auto underscore = _mm_set1_epi8('_');
+	while (position + 16 <= input.size()) {
+		auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + position));
+		auto lower = _mm_or_si128(chunk, case_bit);
+		auto alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, lower_a), _mm_cmplt_epi8(lower, lower_z));
+		auto digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, digit_0), _mm_cmplt_epi8(chunk, digit_9));
+		auto word = _mm_or_si128(_mm_or_si128(alpha, digit), _mm_cmpeq_epi8(chunk, underscore));
+		auto bits = static_cast<unsigned>(_mm_movemask_epi8(word));
+		if (bits != 0xFFFF) {
+			return position + __builtin_ctz(~bits) - start;
+		}
+		position += 16;
+	}
+#endif
+	while (position < input.size() && word_char(input[position])) {
+		position++;
+	}
+	return position - start;
+}
+
+char Lexer::at(std::size_t position) const {
+	return position < input.size() ? input[position] : '\0';
+}
+
+std::pair<std::size_t, std::size_t> TokenStream::position(std::size_t i) const {
+	if(lines.empty()){
+		lines.push_back(0);
+		for(std::size_t j = 0; j < source.size(); j++){
+			if(source[j] == '\n'){
+				lines.push_back(j + 1);
+			}
+		}
+	}
+	auto line = std::upper_bound(lines.begin(), lines.end(), offsets[i]) - lines.begin();
+	return {line, offsets[i] - lines[line - 1] + 1};
 }
 
 Token Lexer::extract_identifier() {
 	std::size_t i = 0;
-	std::string op;
 	if(input[offset] == '\''){
-		if(input[offset + 2] == '\''){
-			op += input[offset + 1];
+		if(at(offset + 2) == '\''){
+			Token token{TokenType::CHAR_LITERAL, input.substr(offset + 1, 1)};
 			offset += 3;
-			Token token{TokenType::CHAR_LITERAL, op};
 			return token;
 		}else{
 			throw std::runtime_error("invalid char literal");
@@ -70,73 +251,39 @@ Token Lexer::extract_identifier() {
 		Token token(TokenType::STRING_LITERAL, op);
 		return token;
 	} */
-	for (; std::isalnum(input[offset + i]) || input[offset + i] == '_'; ++i){
-		op += input[offset + i];
-	}
-	if(keyWords.contains(op)){
-		if(op == "true" || op == "false"){
-			Token token{TokenType::BOOL_LITERAL, std::string(input, offset, i)};
-			offset += i;
-			return token;
-		}
-		Token token{TokenType::KEYWORD, std::string(input, offset, i)};
-		offset += i;
-		return token;
-	}else if(varTypes.contains(op)){
-		Token token{TokenType::VARTYPE, std::string(input, offset, i)};
-		offset += i;
-		return token;
-	}else if(op == "const"){
-		Token token{TokenType::CONST, std::string(input, offset, i)};
-		offset += i;
-		return token;
-	}else{
-		Token token{TokenType::IDENTIFIER, std::string(input, offset, i)};
-		offset += i;
-		return token;
+	i = word_length(offset);
+	Token token{classify(input.substr(offset, i)), input.substr(offset, i)};
+	if (token.type == TokenType::IDENTIFIER) {
+		token.id = Interner::current().intern(token.value);
 	}
+	offset += i;
+	return token;
 }
 
 Token Lexer::extract_number() {
 	std::size_t i = 0;
-	for(; std::isdigit(input[offset + i]); i++);
+	for(; class_of(at(offset + i)) == DIGIT; i++);
 	auto int_len = i;
-	if(input[offset + i] == '.') {
+	if(at(offset + i) == '.') {
 		i++;
 		auto j = i;
-		for (; std::isdigit(input[offset + i]); ++i);
+		for (; class_of(at(offset + i)) == DIGIT; ++i);
 		if (i - j == 0 && int_len == 0) {
 			throw std::runtime_error("Missing int and float part of number");
 		}
-		Token token{TokenType::DOUBLE_LITERAL, std::string(input, offset, i)};
+		Token token{TokenType::DOUBLE_LITERAL, input.substr(offset, i)};
 		offset += i;
 		return token;
 	}else{
-		Token token{TokenType::INT_LITERAL, std::string(input, offset, i)};
+		Token token{TokenType::INT_LITERAL, input.substr(offset, i)};
 		offset += i;
 		return token;
 	}
 }
 
 Token Lexer::extract_operator() {
-	size_t i = 0;
-	std::string op;
-	for (; metachars.contains(input[offset + i]); i++) {
-		op += input[offset + i];
-		if (!operators.contains(op)) {
-			if (i == 0) {//cобытие, которое никогда не случится
-				throw std::runtime_error("Invalid operator");
-			}
-			op.pop_back();
-			break;
-		}
-	}
-	Token token{TokenType::OPERATOR, op};
+	size_t i = is_operator(input[offset], at(offset + 1)) ? 2 : 1;
+	Token token{TokenType::OPERATOR, input.substr(offset, i)};
 	offset += i;
 	return token;
 }
-
-const std::string Lexer::metachars = "+-*/^=!<>|&";
-const std::unordered_set<std::string> Lexer::operators = {"+", "-", "*", "/", "^", "=", "==", "!=", "+=", "-=", "!", "++", "--", "<", ">", "<=", ">=", "||", "&&", "|", "&"};
-const std::unordered_set<std::string> Lexer::keyWords = {"if", "while", "for", "return", "break", "continue", "true", "false"};
-const std::unordered_set<std::string> Lexer::varTypes = { "int", "char", "float", "double", "bool", "void"};
\ No newline at end of file
@@ -1,40 +1,527 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cerrno>
+#include <cstring>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/inotify.h>
 
 #include "lexer.hpp"
 #include "parser.hpp"
 #include "visitor.hpp"
+#include "batch.hpp"
+#include "mapped_file.hpp"
+#include "call_graph.hpp"
+#include "workspace.hpp"
+#include "module.hpp"
+#include "cache.hpp"
+#include "server.hpp"
+#include "jobs.hpp"
+#include "repl.hpp"
 
+namespace {
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-
-int main() {
-    /* std::string input;
-    std::getline(std::cin, input); */
-
-    int file = open("code.txt", O_RDWR , 0666);
-    off_t fileSize = lseek(file, 0, SEEK_END);
-    lseek(file, 0, SEEK_SET);
-    char input[fileSize + 1];
-    ssize_t bytesRead = read(file, input, fileSize);
-    input[bytesRead] = '\0';
-    close(file);
-    std::string str(input);
-    std::cout << str <<std::endl;
-
-    Lexer lexer(str);
-    Parser parser(lexer.tokenize());
-    parser.print_tokens();
-    auto save = parser.parse();
-    Printer printer;
-    printer.print(save);
-    Analyzer analyzer;
-    analyzer.analyze(save);
+//стадии, которые нужно пройти; без флагов программа просто исполняется
+struct Options {
+    bool tokens = false, ast = false, check = false, run = false;
+    bool flat = false, emit_cpp = false, native = false, hash_cons = false, lazy = false, watch = false, cache = false, snapshot = false, repl = false, bench_parse = false;
+    std::string batch_function, batch_rows;
+    std::string serve, connect;//пути сокетов демона
+    std::string jobs;//манифест пакетного запуска
+    std::vector<std::string> files;
+
+    //стадии после разбора, которым нужен проанализированный код
+    bool analyzed() const {
+        return check || run || emit_cpp || native || !batch_function.empty();
+    }
+};
+
+void usage(std::ostream& out) {
+    out << "usage: program [options] file...\n"
+           "  --emit=tokens        print the token stream\n"
+           "  --emit=ast           print the syntax tree\n"
+           "  --check              only run semantic analysis\n"
+           "  --run                analyze and execute (default)\n"
+           "  --flat               use the flat AST for --emit=ast, --check and --run\n"
+           "  --emit-cpp           print the program translated to C++\n"
+           "  --native             compile the C++ translation and run it\n"
+           "  --batch <f> <rows>   call function f for every line of rows\n"
+           "  --hash-cons          share identical literals and pure subexpressions, report the saving\n"
+           "  --lazy               analyze and run only functions reachable from main (and the --batch function)\n"
+           "  --watch              rebuild changed declarations and rerun whenever the file is written\n"
+           "  --cache              reuse the analyzed flat program saved by an earlier run of the same sources\n"
+           "  --snapshot           restore globals as they were on entry to main instead of initializing them\n"
+           "  --serve <socket>     keep compiled programs in memory and run requests sent to the Unix socket\n"
+           "  --connect <socket>   run the file on a --serve daemon, sending standard input along\n"
+           "  --jobs <manifest>    run every \"program input output\" line of the manifest on all cores\n"
+           "  --repl               read, check and run declarations and statements one by one; files are loaded first\n"
+           "  --bench-parse        report lexing and parsing throughput of the files, or of a generated 12 MB source\n"
+           "files may start with import \"path\"; lines; module interfaces are cached between runs\n";
+}
+
+Options parse_options(int argc, char* argv[]) {
+    Options options;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--emit=tokens"){
+            options.tokens = true;
+        }
+        else if(arg == "--emit=ast"){
+            options.ast = true;
+        }
+        else if(arg == "--check"){
+            options.check = true;
+        }
+        else if(arg == "--run"){
+            options.run = true;
+        }
+        else if(arg == "--flat"){
+            options.flat = true;
+        }
+        else if(arg == "--emit-cpp"){
+            options.emit_cpp = true;
+        }
+        else if(arg == "--native"){
+            options.native = true;
+        }
+        else if(arg == "--hash-cons"){
+            options.hash_cons = true;
+        }
+        else if(arg == "--lazy"){
+            options.lazy = true;
+        }
+        else if(arg == "--watch"){
+            options.watch = true;
+        }
+        else if(arg == "--repl"){
+            options.repl = true;
+        }
+        else if(arg == "--bench-parse"){
+            options.bench_parse = true;
+        }
+        else if(arg == "--cache"){
+            options.cache = true;
+        }
+        else if(arg == "--snapshot"){
+            options.snapshot = true;
+        }
+        else if(arg == "--batch"){
+            if(i + 2 >= argc){
+                throw std::runtime_error("--batch needs a function name and a rows file");
+            }
+            options.batch_function = argv[++i];
+            options.batch_rows = argv[++i];
+        }
+        else if(arg == "--jobs"){
+            if(i + 1 >= argc || argc != 3){
+                throw std::runtime_error("--jobs takes a manifest and no other options");
+            }
+            options.jobs = argv[++i];
+        }
+        else if(arg == "--serve" || arg == "--connect"){
+            if(i + 1 >= argc){
+                throw std::runtime_error(arg + " needs a socket path");
+            }
+            (arg == "--serve" ? options.serve : options.connect) = argv[++i];
+        }
+        else if(arg == "--help" || arg == "-h"){
+            usage(std::cout);
+            std::exit(0);
+        }
+        else if(arg.starts_with("-")){
+            throw std::runtime_error("Unknown option " + arg);
+        }
+        else{
+            options.files.push_back(arg);
+        }
+    }
+    if(!options.serve.empty() && argc != 3){
+        throw std::runtime_error("--serve takes no other options");
+    }
+    if(options.repl){
+        if(argc != 2 + static_cast<int>(options.files.size())){
+            throw std::runtime_error("--repl takes only files to load");
+        }
+        return options;
+    }
+    if(options.bench_parse){
+        if(argc != 2 + static_cast<int>(options.files.size())){
+            throw std::runtime_error("--bench-parse takes only files");
+        }
+        return options;
+    }
+    if(options.files.empty()){
+        options.files.push_back("code.txt");
+    }
+    if(!options.connect.empty() && (argc != 4 || options.files.size() != 1)){
+        throw std::runtime_error("--connect takes one file and no other options");
+    }
+    if(!options.tokens && !options.ast && !options.analyzed()){
+        options.run = true;
+    }
+    //в кэше лежит плоское дерево, поэтому --cache работает в плоском режиме
+    if(options.cache){
+        if(options.tokens || options.watch){
+            throw std::runtime_error("--cache only supports --emit=ast, --check and --run");
+        }
+        options.flat = true;
+    }
+    if(options.snapshot && (options.watch || options.native || !options.batch_function.empty())){
+        throw std::runtime_error("--snapshot only supports --run");
+    }
+    if(options.flat && (options.emit_cpp || options.native || !options.batch_function.empty())){
+        throw std::runtime_error("--flat only supports --emit=ast, --check and --run");
+    }
+    if(options.watch && (options.files.size() != 1 || options.tokens || options.flat || options.emit_cpp || options.native || options.lazy || !options.batch_function.empty())){
+        throw std::runtime_error("--watch takes one file and supports --emit=ast, --check and --run");
+    }
+    return options;
+}
+
+//ждёт записи файла; каталог наблюдается целиком, потому что редакторы часто подменяют файл переименованием
+void wait_for_write(int notify, const std::string& name) {
+    alignas(inotify_event) char buffer[4096];
+    for(bool changed = false; !changed;){
+        auto length = read(notify, buffer, sizeof(buffer));
+        if(length <= 0){
+            throw std::runtime_error(std::string("Can't read file events: ") + std::strerror(errno));
+        }
+        for(auto pointer = buffer; pointer < buffer + length;){
+            auto event = reinterpret_cast<inotify_event*>(pointer);
+            changed = changed || (event->len != 0 && name == event->name);
+            pointer += sizeof(inotify_event) + event->len;
+        }
+    }
+}
+
+//--watch: после каждой записи файла заново разбираются и проверяются только изменённые объявления и зависимые от них
+int watch(const Options& options) {
+    auto& path = options.files.front();
+    auto slash = path.rfind('/');
+    auto directory = slash == std::string::npos ? std::string(".") : path.substr(0, slash + 1);
+    auto name = slash == std::string::npos ? path : path.substr(slash + 1);
+    int notify = inotify_init1(IN_CLOEXEC);
+    if(notify < 0 || inotify_add_watch(notify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0){
+        throw std::runtime_error("Can't watch " + path + ": " + std::strerror(errno));
+    }
+    Workspace workspace;
+    while(true){
+        try{
+            MappedFile source(path);
+            if(!read_header(source.text()).imports.empty()){
+                throw std::runtime_error("--watch does not follow imports");
+            }
+            auto& program = workspace.update(source.text());
+            auto& stats = workspace.stats();
+            std::cerr << "watch: " << stats.declarations << " declarations, " << stats.parsed << " parsed, "
+                      << stats.checked << " checked" << std::endl;
+            if(options.ast){
+                Printer printer;
+                printer.print(program);
+            }
+            if(options.run){
+                Executor executor;
+                executor.execute(program);
+            }
+        }
+        catch(const std::exception& error){
+            std::cout.flush();
+            std::cerr << "error: " << error.what() << std::endl;
+        }
+        std::cout.flush();
+        wait_for_write(notify, name);
+    }
+}
+
+//--snapshot: инициализация глобальных выполняется один раз, дальше их значения на входе в main восстанавливаются из файла
+template<class Program>
+void run_snapshot(const Program& program, std::uint64_t key) {
+    auto path = (cache_directory() / (hex(key) + ".snap")).string();
+    Executor executor;
+    std::optional<std::size_t> entry;
+    //повреждённый или не подходящий программе снимок пересоздаётся
+    if(auto snapshot = Snapshot::load(path, key); snapshot && (entry = executor.restore(program, *snapshot))){
+        std::cout << snapshot->output;
+    }
+    else{
+        //вывод инициализации перехватывается, чтобы повторить его при восстановлении
+        std::ostringstream output;
+        auto console = std::cout.rdbuf(output.rdbuf());
+        try{
+            entry = executor.initialize(program);
+        }
+        catch(...){
+            std::cout.rdbuf(console);
+            std::cout << output.str();
+            throw;
+        }
+        std::cout.rdbuf(console);
+        std::cout << output.str();
+        if(!executor.reads_input()){
+            auto snapshot = executor.capture();
+            snapshot.output = output.str();
+            snapshot.save(path, key);
+        }
+    }
+    executor.finish(program, *entry);
+}
+
+template<class Program>
+void run(const Options& options, const Program& program, std::uint64_t key) {
+    if(options.snapshot){
+        run_snapshot(program, key);
+        return;
+    }
     Executor executor;
-    executor.execute(save);
+    executor.execute(program);
+}
+
+//функции с циклами, ветвлениями и арифметикой, пока текст не достигнет size байт
+std::string generated_source(std::size_t size) {
+    std::string source;
+    for(std::size_t i = 0; source.size() < size; i++){
+        auto name = "f" + std::to_string(i);
+        source += "int " + name + "(int a, int b){\n"
+                  "    int s = 0;\n"
+                  "    int i = 0;\n"
+                  "    while(i < a){\n"
+                  "        s = s + i * b - (a / 3);\n"
+                  "        if(s > 1000){\n"
+                  "            s -= 1000;\n"
+                  "        }\n"
+                  "        i++;\n"
+                  "    }\n"
+                  "    double d = 1.5 * 2.0;\n"
+                  "    bool done = s >= 0 && i == a;\n"
+                  "    return s + " + std::to_string(i % 97) + ";\n"
+                  "}\n";
+    }
+    return source + "int main(){\n    return 0;\n}\n";
+}
+
+//--bench-parse: лексер и парсер в одном потоке, лучший из пяти прогонов
+int bench_parse(const std::vector<std::string>& files) {
+    std::vector<std::string> texts;
+    for(auto& path : files){
+        texts.emplace_back(MappedFile(path).text());
+    }
+    if(texts.empty()){
+        texts.push_back(generated_source(12 << 20));
+    }
+    std::size_t bytes = 0;
+    for(auto& text : texts){
+        bytes += text.size();
+    }
+    auto best = std::numeric_limits<double>::infinity();
+    for(int run = 0; run < 5; run++){
+        auto start = std::chrono::steady_clock::now();
+        for(auto& text : texts){
+            Arena arena;
+            Parser parser(Lexer(text, read_header(text).body), arena);
+            parser.parse();
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::cout << std::fixed << std::setprecision(1) << "parse: " << bytes / 1e6 << " MB, best of 5: "
+              << std::setprecision(3) << best << " s, " << std::setprecision(1) << bytes / 1e6 / best << " MB/s" << std::endl;
     return 0;
-}
\ No newline at end of file
+}
+
+//стадии после анализа плоского дерева: печать и исполнение
+void run_flat(const Options& options, const FlatAst& flat, std::uint64_t key) {
+    if(options.ast){
+        Printer printer;
+        printer.print(flat);
+    }
+    if(options.run){
+        run(options, flat, key);
+    }
+}
+
+int drive(const Options& options) {
+    if(options.watch){
+        return watch(options);
+    }
+    if(options.bench_parse){
+        return bench_parse(options.files);
+    }
+    if(!options.serve.empty()){
+        Server server(options.serve);
+        server.serve();
+    }
+    if(options.repl){
+        Repl repl(std::cin, std::cout);
+        for(auto& path : options.files){
+            MappedFile source(path);
+            repl.submit(source.text(), std::cerr);
+        }
+        repl.run(std::cin, std::cerr, isatty(STDIN_FILENO));
+        return 0;
+    }
+    if(!options.jobs.empty()){
+        auto report = run_jobs(read_manifest(options.jobs), std::cerr);
+        report.print(std::cerr);
+        return report.failed == 0 ? 0 : 1;
+    }
+    if(!options.connect.empty()){
+        MappedFile source(options.files.front());
+        request(options.connect, source.text(), std::cin, std::cout);
+        return 0;
+    }
+    //отображения живут до конца, токены и дерево ссылаются на их страницы
+    std::vector<MappedFile> sources;
+    sources.reserve(options.files.size());
+    for(auto& path : options.files){
+        sources.emplace_back(path);
+    }
+
+    std::vector<ModuleHeader> headers;
+    for(auto& source : sources){
+        try{
+            headers.push_back(read_header(source.text()));
+        }
+        catch(const std::exception& error){
+            throw std::runtime_error(source.path() + ": " + error.what());
+        }
+    }
+
+    //ключ - тексты файлов, версии формата и анализатора (загруженное дерево не перепроверяется) и флаги, от которых зависит сохранённое дерево
+    std::uint64_t key = content_hash(options.lazy ? "lazy" : "", content_hash("flat-ast " + std::to_string(FlatAst::version()) + " analyzer " + std::to_string(Analyzer::version())));
+    std::string cached;
+    if(options.cache || options.snapshot){
+        for(std::size_t i = 0; i < sources.size(); i++){
+            if(!headers[i].imports.empty()){
+                throw std::runtime_error("--cache and --snapshot do not follow imports");
+            }
+            key = content_hash(sources[i].text(), content_hash(std::to_string(sources[i].text().size()), key));
+        }
+    }
+    if(options.cache){
+        cached = (cache_directory() / (hex(key) + ".flat")).string();
+        if(auto flat = FlatAst::load(cached, key)){
+            run_flat(options, *flat, key);
+            return 0;
+        }
+    }
+
+    Arena arena;
+    if(options.tokens){
+        for(std::size_t i = 0; i < sources.size(); i++){
+            Parser parser(Lexer(sources[i].text(), headers[i].body), arena);
+            parser.print_tokens();
+        }
+    }
+    if(!options.ast && !options.analyzed()){
+        return 0;
+    }
+
+    ModuleLoader modules;
+    std::vector<statement> program;
+    HashCons::Stats consed;
+    for(std::size_t i = 0; i < sources.size(); i++){
+        if(!headers[i].imports.empty()){
+            modules.load(sources[i].path(), headers[i].imports);
+        }
+        auto part = Parser::parse_parallel(sources[i].text(), arena, 0, options.hash_cons ? &consed : nullptr, headers[i].body);
+        program.insert(program.end(), part.begin(), part.end());
+    }
+    if(options.hash_cons){
+        std::cerr << "hash-cons: " << consed.unique << " unique nodes, " << consed.shared << " shared, "
+                  << consed.saved << " of " << arena.bytes() + consed.saved << " bytes saved" << std::endl;
+    }
+    //недостижимые функции дальше разбора не идут
+    if(options.lazy){
+        std::vector<symbol> roots{symbols::main};
+        if(!options.batch_function.empty()){
+            roots.push_back(Interner::current().intern(options.batch_function));
+        }
+        program = CallGraph(program).reachable(roots);
+    }
+    //из модулей берутся только нужные объявления, уже проверенные
+    std::vector<Analyzer::Unit> units;
+    if(!modules.empty()){
+        std::vector<symbol> roots;
+        if(!options.batch_function.empty()){
+            roots.push_back(Interner::current().intern(options.batch_function));
+        }
+        auto linked = modules.link(program, units, roots);
+        program.insert(program.begin(), linked.begin(), linked.end());
+        units.resize(program.size());
+    }
+
+    if(options.flat){
+        auto flat = FlatAst::build(program);
+        if(options.analyzed()){
+            Analyzer analyzer;
+            analyzer.analyze(flat);
+            //в кэш попадает только проверенная программа
+            if(options.cache){
+                flat.save(cached, key);
+            }
+        }
+        run_flat(options, flat, key);
+        return 0;
+    }
+
+    if(options.ast){
+        Printer printer;
+        printer.print(program);
+    }
+    if(!options.analyzed()){
+        return 0;
+    }
+    Analyzer analyzer;
+    analyzer.analyze_parallel(program, 0, modules.empty() ? nullptr : &units);
+
+    if(options.emit_cpp || options.native){
+        Transpiler transpiler;
+        auto code = transpiler.transpile(program);
+        if(options.emit_cpp){
+            std::cout << code;
+        }
+        if(options.native){
+            std::cout.flush();
+            auto binary = Transpiler::build(code);
+            execl(binary.c_str(), binary.c_str(), nullptr);
+            perror("execl");
+            return 1;
+        }
+    }
+    //--batch <функция> <файл>: функция считается сразу для всех строк файла
+    if(!options.batch_function.empty()){
+        std::ifstream rows(options.batch_rows);
+        if(!rows){
+            throw std::runtime_error("Can't open " + options.batch_rows);
+        }
+        BatchExecutor batch(program);
+        batch.run(options.batch_function, rows, std::cout);
+    }
+    if(options.run){
+        run(options, program, key);
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    try{
+        return drive(parse_options(argc, argv));
+    }
+    catch(const std::exception& error){
+        std::cout.flush();
+        std::cerr << "error: " << error.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,46 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.hpp"
+
+MappedFile::MappedFile(const std::string& path) : name(path) {
+    int file = open(path.c_str(), O_RDONLY);
+    if(file < 0){
+        throw std::runtime_error("Can't open " + path + ": " + std::strerror(errno));
+    }
+    struct stat info;
+    if(fstat(file, &info) < 0){
+        auto error = errno;
+        close(file);
+        throw std::runtime_error("Can't stat " + path + ": " + std::strerror(error));
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    //пустой файл отображать нельзя, ему хватает пустого вида
+    if(size != 0){
+        auto pointer = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        if(pointer == MAP_FAILED){
+            auto error = errno;
+            close(file);
+            throw std::runtime_error("Can't map " + path + ": " + std::strerror(error));
+        }
+        madvise(pointer, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(pointer);
+    }
+    close(file);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : name(std::move(other.name)), data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {}
+
+MappedFile::~MappedFile() {
+    if(data != nullptr){
+        munmap(const_cast<char*>(data), size);
+    }
+}
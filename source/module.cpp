@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+#include <unistd.h>
+
+#include "module.hpp"
+#include "cache.hpp"
+#include "call_graph.hpp"
+#include "parser.hpp"
+
+namespace {
+
+constexpr std::string_view interface_version = "module-interface 1";
+
+bool blank(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+std::vector<std::string> spellings(const std::vector<symbol>& names) {
+    std::vector<std::string> result;
+    for(auto name : names){
+        result.push_back(spelling(name));
+    }
+    return result;
+}
+
+std::vector<symbol> interned(const std::vector<std::string>& names) {
+    std::vector<symbol> result;
+    for(auto& name : names){
+        result.push_back(Interner::current().intern(name));
+    }
+    return result;
+}
+
+std::string declared_name(statement decl) {
+    if(auto var = dynamic_cast<VarDeclStatement*>(decl)){
+        return spelling(var->var->name);
+    }
+    if(auto func = dynamic_cast<FuncDeclStatement*>(decl)){
+        return spelling(func->func->funcName);
+    }
+    return "";
+}
+
+}
+
+ModuleHeader read_header(std::string_view source) {
+    ModuleHeader header;
+    std::size_t pos = 0;
+    auto skip = [&] {
+        while(pos < source.size() && blank(source[pos])){
+            pos++;
+        }
+    };
+    auto malformed = [&] {
+        auto line = std::count(source.begin(), source.begin() + pos, '\n') + 1;
+        return std::runtime_error("Malformed import at line " + std::to_string(line));
+    };
+    while(true){
+        skip();
+        if(source.substr(pos, 6) != "import" || (pos + 6 < source.size() && !blank(source[pos + 6]) && source[pos + 6] != '"')){
+            break;
+        }
+        pos += 6;
+        skip();
+        if(pos >= source.size() || source[pos] != '"'){
+            throw malformed();
+        }
+        auto close = source.find_first_of("\"\n", pos + 1);
+        if(close == std::string_view::npos || source[close] != '"'){
+            throw malformed();
+        }
+        header.imports.emplace_back(source.substr(pos + 1, close - pos - 1));
+        pos = close + 1;
+        skip();
+        if(pos >= source.size() || source[pos] != ';'){
+            throw malformed();
+        }
+        header.body = ++pos;
+    }
+    return header;
+}
+
+ModuleLoader::ModuleLoader(unsigned threads) : threads(threads) {
+    if(this->threads == 0){
+        this->threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+void ModuleLoader::load(const std::string& importer, const std::vector<std::string>& imports) {
+    auto directory = std::filesystem::path(importer).parent_path();
+    std::vector<std::string> stack{std::filesystem::weakly_canonical(importer).string()};
+    auto first = order.size();
+    for(auto& path : imports){
+        open((directory / path).string(), stack);
+    }
+    std::vector<Module*> fresh(order.begin() + first, order.end());
+    counters.modules = order.size();
+
+    //модули одного уровня друг от друга не зависят и проверяются параллельно
+    std::size_t levels = 0;
+    for(auto module : fresh){
+        levels = std::max(levels, module->level + 1);
+    }
+    for(std::size_t level = 0; level < levels; level++){
+        std::vector<Module*> batch;
+        for(auto module : fresh){
+            if(module->level == level){
+                batch.push_back(module);
+            }
+        }
+        std::vector<std::exception_ptr> errors(batch.size());
+        std::atomic<std::size_t> next = 0;
+        auto& names = Interner::current();
+        auto worker = [&] {
+            Interner::Use use(names);
+            for(auto i = next++; i < batch.size(); i = next++){
+                try{
+                    compile(*batch[i]);
+                }catch(...){
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+        {
+            std::vector<std::jthread> pool;
+            for(unsigned i = 1; i < std::min<std::size_t>(threads, batch.size()); i++){
+                pool.emplace_back(worker);
+            }
+            worker();
+        }
+        for(std::size_t i = 0; i < batch.size(); i++){
+            if(errors[i]){
+                std::rethrow_exception(errors[i]);
+            }
+            if(!batch[i]->cached){
+                counters.compiled++;
+            }
+        }
+    }
+}
+
+Module* ModuleLoader::open(const std::string& path, std::vector<std::string>& stack) {
+    auto canonical = std::filesystem::weakly_canonical(path).string();
+    if(std::find(stack.begin(), stack.end(), canonical) != stack.end()){
+        std::string cycle;
+        for(auto& item : stack){
+            cycle += item + " -> ";
+        }
+        throw std::runtime_error("Import cycle: " + cycle + canonical);
+    }
+    if(auto it = modules.find(canonical); it != modules.end()){
+        return it->second.get();
+    }
+
+    auto module = std::make_unique<Module>(canonical);
+    auto text = module->source.text();
+    ModuleHeader header;
+    try{
+        header = read_header(text);
+    }catch(const std::exception& error){
+        throw std::runtime_error(canonical + ": " + error.what());
+    }
+    module->body = header.body;
+    stack.push_back(canonical);
+    auto directory = std::filesystem::path(canonical).parent_path();
+    for(auto& import : header.imports){
+        auto imported = open((directory / import).string(), stack);
+        module->imports.push_back(imported);
+        module->level = std::max(module->level, imported->level + 1);
+    }
+    stack.pop_back();
+
+    //ключ меняется и при правке импортов: от их сигнатур зависят итоги проверки модуля
+    module->key = content_hash(text, content_hash(interface_version, content_hash("analyzer " + std::to_string(Analyzer::version()))));
+    for(auto imported : module->imports){
+        module->key = content_hash(hex(imported->key), module->key);
+    }
+    auto result = module.get();
+    order.push_back(result);
+    modules.emplace(canonical, std::move(module));
+    return result;
+}
+
+//разбирает объявление модуля по его диапазону; лексер идёт по всему файлу ради настоящих позиций в ошибках
+statement ModuleLoader::declaration(Module& module, std::size_t index) {
+    std::lock_guard lock(module.mutex);
+    if(module.parsed.size() != module.declarations.size()){
+        module.parsed.resize(module.declarations.size(), nullptr);
+    }
+    if(module.parsed[index] == nullptr){
+        auto& decl = module.declarations[index];
+        auto text = module.source.text();
+        auto decls = Parser(Lexer(text.substr(0, decl.end), decl.begin), *module.arena).parse();
+        if(decls.size() != 1 || declared_name(decls.front()) != decl.name || Analyzer::signature(decls.front()) != decl.signature){
+            throw std::runtime_error("Stale interface of module " + module.source.path());
+        }
+        module.parsed[index] = decls.front();
+    }
+    return module.parsed[index];
+}
+
+//объявления из modules, до которых можно дойти от names, в порядке модулей и их текста
+std::vector<statement> ModuleLoader::closure(const std::vector<Module*>& scope, const std::vector<symbol>& names, std::vector<Analyzer::Unit>& units) {
+    std::unordered_map<symbol, std::pair<Module*, std::size_t>> defined;
+    for(auto module : scope){
+        for(std::size_t i = 0; i < module->declarations.size(); i++){
+            auto name = Interner::current().intern(module->declarations[i].name);
+            if(!defined.try_emplace(name, module, i).second){
+                throw std::runtime_error("Redeclaration of symbol " + spelling(name) + ".");//как если бы модули были одним файлом
+            }
+        }
+    }
+    std::unordered_set<symbol> seen;
+    std::unordered_map<Module*, std::vector<bool>> needed;
+    std::vector<symbol> pending(names);
+    while(!pending.empty()){
+        auto name = pending.back();
+        pending.pop_back();
+        auto it = defined.find(name);
+        if(!seen.insert(name).second || it == defined.end()){
+            continue;
+        }
+        auto [module, index] = it->second;
+        auto& marks = needed[module];
+        marks.resize(module->declarations.size());
+        marks[index] = true;
+        auto next = interned(module->declarations[index].references);
+        pending.insert(pending.end(), next.begin(), next.end());
+    }
+
+    std::vector<statement> result;
+    for(auto module : scope){
+        auto marks = needed.find(module);
+        for(std::size_t i = 0; marks != needed.end() && i < marks->second.size(); i++){
+            if(!marks->second[i]){
+                continue;
+            }
+            auto& decl = module->declarations[i];
+            result.push_back(declaration(*module, i));
+            auto& unit = units.emplace_back();
+            unit.reads = interned(decl.reads);
+            unit.assigned = interned(decl.assigned);
+            unit.checked = true;
+        }
+    }
+    return result;
+}
+
+std::vector<statement> ModuleLoader::link(const std::vector<statement>& program, std::vector<Analyzer::Unit>& units, const std::vector<symbol>& roots) {
+    std::vector<symbol> names(roots);
+    for(auto decl : program){
+        auto references = CallGraph::references(decl);
+        names.insert(names.end(), references.begin(), references.end());
+    }
+    auto result = closure(order, names, units);
+    counters.linked = result.size();
+    return result;
+}
+
+void ModuleLoader::compile(Module& module) {
+    if(read_interface(module)){
+        module.cached = true;
+        return;
+    }
+    auto text = module.source.text();
+    auto ends = Parser::declaration_ends(text);
+    std::erase_if(ends, [&](std::size_t end) { return end <= module.body; });
+    if(std::any_of(text.begin() + (ends.empty() ? module.body : ends.back()), text.end(), [](char c) { return !blank(c); })){
+        ends.push_back(text.size());
+    }
+
+    std::vector<statement> own;
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    try{
+        auto begin = module.body;
+        for(auto end : ends){
+            while(begin < end && blank(text[begin])){
+                begin++;
+            }
+            for(auto decl : Parser(Lexer(text.substr(0, end), begin), *module.arena).parse()){
+                own.push_back(decl);
+                ranges.emplace_back(begin, end);
+            }
+            begin = end;
+        }
+    }catch(const std::exception& error){
+        throw std::runtime_error(module.source.path() + ": " + error.what());
+    }
+
+    //видны все модули, импортированные прямо или через другие
+    std::vector<Module*> scope;
+    std::vector<Module*> pending(module.imports);
+    while(!pending.empty()){
+        auto next = pending.back();
+        pending.pop_back();
+        if(std::find(scope.begin(), scope.end(), next) == scope.end()){
+            scope.push_back(next);
+            pending.insert(pending.end(), next->imports.begin(), next->imports.end());
+        }
+    }
+    std::sort(scope.begin(), scope.end(), [&](Module* a, Module* b) {
+        return std::find(order.begin(), order.end(), a) < std::find(order.begin(), order.end(), b);
+    });
+    std::vector<symbol> names;
+    for(auto decl : own){
+        auto references = CallGraph::references(decl);
+        names.insert(names.end(), references.begin(), references.end());
+    }
+    std::vector<Analyzer::Unit> units;
+    std::vector<statement> program;
+    std::size_t imported = 0;
+    try{
+        program = closure(scope, names, units);
+        imported = program.size();
+        program.insert(program.end(), own.begin(), own.end());
+        Analyzer analyzer;
+        analyzer.analyze_library(program, units, 1);
+    }catch(const std::exception& error){
+        throw std::runtime_error(module.source.path() + ": " + error.what());
+    }
+
+    for(std::size_t i = 0; i < own.size(); i++){
+        auto& unit = units[imported + i];
+        auto& decl = module.declarations.emplace_back();
+        decl.name = declared_name(own[i]);
+        decl.begin = ranges[i].first;
+        decl.end = ranges[i].second;
+        decl.signature = Analyzer::signature(own[i]);
+        decl.references = spellings(CallGraph::references(own[i]));
+        decl.reads = spellings(unit.reads);
+        decl.assigned = spellings(unit.assigned);
+    }
+    module.parsed = std::move(own);
+    write_interface(module);
+}
+
+//строки интерфейса: decl начало конец имя, затем sig, refs, reads и assigned этого объявления
+bool ModuleLoader::read_interface(Module& module) {
+    std::ifstream in(cache_directory() / (hex(module.key) + ".iface"));
+    std::string line;
+    if(!in || !std::getline(in, line) || line != interface_version){
+        return false;
+    }
+    std::vector<ModuleDeclaration> declarations;
+    auto words = [](const std::string& rest) {
+        std::vector<std::string> result;
+        std::istringstream stream(rest);
+        for(std::string word; stream >> word;){
+            result.push_back(word);
+        }
+        return result;
+    };
+    while(std::getline(in, line)){
+        auto space = line.find(' ');
+        auto tag = line.substr(0, space);
+        auto rest = space == std::string::npos ? "" : line.substr(space + 1);
+        if(tag == "decl"){
+            auto& decl = declarations.emplace_back();
+            std::istringstream stream(rest);
+            if(!(stream >> decl.begin >> decl.end >> decl.name)){
+                return false;
+            }
+        }else if(declarations.empty()){
+            return false;
+        }else if(tag == "sig"){
+            declarations.back().signature = rest;
+        }else if(tag == "refs"){
+            declarations.back().references = words(rest);
+        }else if(tag == "reads"){
+            declarations.back().reads = words(rest);
+        }else if(tag == "assigned"){
+            declarations.back().assigned = words(rest);
+        }else{
+            return false;
+        }
+    }
+    module.declarations = std::move(declarations);
+    return true;
+}
+
+void ModuleLoader::write_interface(const Module& module) {
+    auto join = [](const std::vector<std::string>& words) {
+        std::string result;
+        for(auto& word : words){
+            result += " " + word;
+        }
+        return result;
+    };
+    auto dir = cache_directory();
+    auto name = hex(module.key) + ".iface";
+    auto temp = dir / (name + "." + std::to_string(getpid()) + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())));
+    {
+        std::ofstream out(temp);
+        out << interface_version << "\n";
+        for(auto& decl : module.declarations){
+            out << "decl " << decl.begin << " " << decl.end << " " << decl.name << "\n";
+            out << "sig " << decl.signature << "\n";
+            out << "refs" << join(decl.references) << "\n";
+            out << "reads" << join(decl.reads) << "\n";
+            out << "assigned" << join(decl.assigned) << "\n";
+        }
+    }
+    std::filesystem::rename(temp, dir / name);//атомарно для параллельных сборок
+}
@@ -2,31 +2,138 @@
 #include <vector>
 #include <stdexcept>
 #include <iostream>
+#include <charconv>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <thread>
 #include "parser.hpp"
 
 #define MIN_PRECEDENCE 0
 
-Parser::Parser(const std::vector<Token>& tokens) : tokens(tokens), offset(0) {}
+Parser::Parser(Lexer lexer, Arena& arena, bool hash_cons) : lexer(lexer), arena(arena), nodes(arena, hash_cons) {}
 
 std::vector<statement> Parser::parse() {
 	std::vector<statement> declList;
-	while(tokens[offset] != TokenType::END){
+	while(lexer.peek() != TokenType::END){
 		declList.push_back(parse_decl_statement());
 	}
 	return declList;
 }
 
+std::vector<statement> Parser::parse_statements() {
+	std::vector<statement> statements;
+	while(lexer.peek() != TokenType::END){
+		statements.push_back(parse_statement());
+	}
+	return statements;
+}
+
+//концы объявлений верхнего уровня: ';' или '}' на нулевой глубине скобок
+std::vector<std::size_t> Parser::declaration_ends(std::string_view source) {
+	std::vector<std::size_t> ends;
+	int depth = 0;
+	for (std::size_t i = 0; i < source.size(); i++) {
+		switch (source[i]) {
+			case '\'':
+				i += 2;
+				break;
+			case '{':
+				depth++;
+				break;
+			case '}':
+				if (--depth == 0) {
+					ends.push_back(i + 1);
+				}
+				break;
+			case ';':
+				if (depth == 0) {
+					ends.push_back(i + 1);
+				}
+				break;
+		}
+	}
+	return ends;
+}
+
+std::vector<statement> Parser::parse_parallel(std::string_view source, Arena& arena, unsigned threads, HashCons::Stats* stats, std::size_t begin) {
+	constexpr std::size_t min_chunk = 1 << 16;
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	//несколько кусков на поток, чтобы длинные функции не тормозили остальные
+	auto target = std::max(min_chunk, source.size() / (threads * 4));
+	std::vector<std::pair<std::size_t, std::size_t>> chunks;
+	for (auto end : declaration_ends(source)) {
+		if (end > begin && end - begin >= target) {
+			chunks.emplace_back(begin, end);
+			begin = end;
+		}
+	}
+	chunks.emplace_back(begin, source.size());
+	if (chunks.size() == 1 || threads == 1) {
+		Parser parser(Lexer(source, chunks.front().first), arena, stats != nullptr);
+		auto declList = parser.parse();
+		if (stats != nullptr) {
+			*stats += parser.hash_cons_stats();
+		}
+		return declList;
+	}
+
+	std::vector<std::vector<statement>> parts(chunks.size());
+	std::vector<std::unique_ptr<Arena>> arenas(chunks.size());
+	std::vector<std::exception_ptr> errors(chunks.size());
+	std::vector<HashCons::Stats> consed(chunks.size());
+	std::atomic<std::size_t> next = 0;
+	auto& names = Interner::current();
+	auto worker = [&] {
+		Interner::Use use(names);
+		for (auto i = next++; i < chunks.size(); i = next++) {
+			try {
+				arenas[i] = std::make_unique<Arena>();
+				Parser parser(Lexer(source.substr(0, chunks[i].second), chunks[i].first), *arenas[i], stats != nullptr);
+				parts[i] = parser.parse();
+				consed[i] = parser.hash_cons_stats();
+			} catch (...) {
+				errors[i] = std::current_exception();
+			}
+		}
+	};
+	{
+		std::vector<std::jthread> pool;
+		for (unsigned i = 1; i < std::min<std::size_t>(threads, chunks.size()); i++) {
+			pool.emplace_back(worker);
+		}
+		worker();
+	}
+
+	std::vector<statement> declList;
+	for (std::size_t i = 0; i < chunks.size(); i++) {
+		if (errors[i]) {
+			std::rethrow_exception(errors[i]);
+		}
+		std::move(parts[i].begin(), parts[i].end(), std::back_inserter(declList));
+		arena.adopt(std::move(arenas[i]));
+		if (stats != nullptr) {
+			*stats += consed[i];
+		}
+	}
+	return declList;
+}
+
 std::string Parser::parse_var_type(){
 	return extract(TokenType::VARTYPE);
 }
 
-std::string Parser::parse_identifier(){
-	return extract(TokenType::IDENTIFIER);
+symbol Parser::parse_identifier(){
+	return extract_symbol();
 }
 
-std::vector<std::shared_ptr<VarDefinition>> Parser::parse_param_list(){
+std::pmr::vector<VarDefinition*> Parser::parse_param_list(){
 	extract(TokenType::LPAREN);
-	std::vector<std::shared_ptr<VarDefinition>> args;
+	std::pmr::vector<VarDefinition*> args(&arena);
 	if (!match(TokenType::RPAREN)) {
 		while (true) {
 			args.push_back(parse_arg());
@@ -43,21 +150,21 @@ std::vector<std::shared_ptr<VarDefinition>> Parser::parse_param_list(){
 	return args;
 }
 
-std::shared_ptr<VarDefinition> Parser::parse_arg(){
+VarDefinition* Parser::parse_arg(){
 	bool flag = false;
 	if(match(TokenType::CONST)){
 		flag = true;
 		extract(TokenType::CONST);
 	}
 	auto type = extract(TokenType::VARTYPE);
-	auto name = extract(TokenType::IDENTIFIER);
-	return make_shared<VarDefinition>(type, name, nullptr, flag);
+	auto name = extract_symbol();
+	return arena.make<VarDefinition>(type, name, nullptr, flag);
 }
 
 statement Parser::parse_block_statement(){
 	extract(TokenType::LBRACE);
 	if (!match(TokenType::RBRACE)) {
-		std::vector<statement> commands;
+		std::pmr::vector<statement> commands(&arena);
 		while (true) {
 			commands.push_back(parse_statement());
 			if (match(TokenType::RBRACE)) {
@@ -65,7 +172,7 @@ statement Parser::parse_block_statement(){
 				break;
 			}
 		}
-		return make_shared<BlockStatement>(commands);
+		return arena.make<BlockStatement>(std::move(commands));
 	}else {
 		extract(TokenType::RBRACE);
 		return nullptr;
@@ -73,32 +180,32 @@ statement Parser::parse_block_statement(){
 }
 
 statement Parser::parse_statement(){
-	if(tokens[offset].value == "if"){
-		offset++;
+	if(lexer.peek().value == "if"){
+		lexer.next();
 		auto expr = parse_cond_statement();
 		auto if_statement = parse_block_statement();
-		if(tokens[offset].value == "else"){
-			offset++;
-			if(tokens[offset].value == "if"){
-				return make_shared<CondStatement>(expr, if_statement, parse_statement());
-			}else if(tokens[offset].value == "{"){
-				return make_shared<CondStatement>(expr, if_statement, parse_block_statement());
+		if(lexer.peek().value == "else"){
+			lexer.next();
+			if(lexer.peek().value == "if"){
+				return arena.make<CondStatement>(expr, if_statement, parse_statement());
+			}else if(lexer.peek().value == "{"){
+				return arena.make<CondStatement>(expr, if_statement, parse_block_statement());
 			}else{
 				std::runtime_error("Unknown instruction");
 			}
 		}else{
-			return make_shared<CondStatement>(expr, if_statement);
+			return arena.make<CondStatement>(expr, if_statement);
 		}
-	}else if(tokens[offset].value == "while"){
-		offset++;
+	}else if(lexer.peek().value == "while"){
+		lexer.next();
 		auto expr = parse_cond_statement();
-		return make_shared<WhileLoopStatement>(expr, parse_block_statement());
-	/*} else if(tokens[offset].value == "for"){
-		offset++;
+		return arena.make<WhileLoopStatement>(expr, parse_block_statement());
+	/*} else if(lexer.peek().value == "for"){
+		lexer.next();
 		return parse_for_statement(); */
-	}else if(tokens[offset].type == TokenType::VARTYPE || tokens[offset].type == TokenType::CONST){
+	}else if(lexer.peek().type == TokenType::VARTYPE || lexer.peek().type == TokenType::CONST){
 		return parse_decl_statement();
-	}else if(tokens[offset].value == "break" || tokens[offset].value == "continue" || tokens[offset].value == "return"){
+	}else if(lexer.peek().value == "break" || lexer.peek().value == "continue" || lexer.peek().value == "return"){
 		return parse_jump_statement();
 	}
 
@@ -112,22 +219,21 @@ statement Parser::parse_decl_statement(){
 		extract(TokenType::CONST);
 	}
 	std::string type = extract(TokenType::VARTYPE);
-	std::string name = extract(TokenType::IDENTIFIER);
-	if(tokens[offset].type == TokenType::LPAREN && !flag){
+	symbol name = extract_symbol();
+	if(lexer.peek().type == TokenType::LPAREN && !flag){
 		auto params = parse_param_list();
 		auto statements = parse_block_statement();
-		auto funcDefinition = std::make_shared<FuncDefinition>(type, name, params, statements);
-		return std::make_shared<FuncDeclStatement>(funcDefinition);
+		auto funcDefinition = arena.make<FuncDefinition>(type, name, std::move(params), statements);
+		return arena.make<FuncDeclStatement>(funcDefinition);
 	}else{
-		auto varDefinition = std::make_shared<VarDefinition>(type, name, parse_var_value(), flag);
-		return std::make_shared<VarDeclStatement>(varDefinition);
+		auto varDefinition = arena.make<VarDefinition>(type, name, parse_var_value(), flag);
+		return arena.make<VarDeclStatement>(varDefinition);
 	}
 }
 
 expr Parser::parse_var_value(){
-	expr retValue;
-	if(tokens[offset].value == "="){
-		offset++;
+	if(lexer.peek().value == "="){
+		lexer.next();
 		auto retVal = parse_binary_expression(MIN_PRECEDENCE);
 		extract(TokenType::SEMICOLON);
 		return retVal;
@@ -149,97 +255,162 @@ expr Parser::parse_cond_statement(){
 	}
 }
 
-std::shared_ptr<JumpStatement> Parser::parse_jump_statement(){
-	std::string val = tokens[offset++].value;
+JumpStatement* Parser::parse_jump_statement(){
+	std::string val(lexer.next().value);
 	if(val != "return"){
 		extract(TokenType::SEMICOLON);
-		return make_shared<JumpStatement>(val, nullptr);
+		return arena.make<JumpStatement>(val, nullptr);
 	}else{
 		if(match(TokenType::SEMICOLON)){
 			extract(TokenType::SEMICOLON);
-			return make_shared<JumpStatement>(val, nullptr);
+			return arena.make<JumpStatement>(val, nullptr);
 		}else{
 			auto expr = parse_binary_expression(MIN_PRECEDENCE);
 			extract(TokenType::SEMICOLON);
-			return make_shared<JumpStatement>(val, expr);
+			return arena.make<JumpStatement>(val, expr);
 		}
 	}
 }
 
-std::shared_ptr<ExprStatement> Parser::parse_expr_statement(){
+ExprStatement* Parser::parse_expr_statement(){
 	auto expr = parse_binary_expression(MIN_PRECEDENCE);
-	auto retVal = std::make_shared<ExprStatement>(expr);
+	auto retVal = arena.make<ExprStatement>(expr);
 	extract(TokenType::SEMICOLON);
 	return retVal;
 }
 
-expr Parser::parse_binary_expression(int min_precedence) {
+namespace {
+
+//присваивания идут первыми: операторы после DIV_ASSIGN переменных не меняют
+enum class BinaryOp : std::uint8_t {
+	NONE, ASSIGN, ADD_ASSIGN, SUB_ASSIGN, MUL_ASSIGN, DIV_ASSIGN, OR, AND, XOR,
+	EQUAL, NOT_EQUAL, LESS, GREATER, LESS_EQUAL, GREATER_EQUAL, ADD, SUB, MUL, DIV, COUNT
+};
+
+//сила связывания слева и справа: правая меньше левой - правоассоциативный оператор
+struct BindingPower {
+	int left, right;
+};
+
+constexpr auto binding_powers = [] {
+	std::array<BindingPower, static_cast<std::size_t>(BinaryOp::COUNT)> table{};
+	auto set = [&](BinaryOp op, int left, int right) { table[static_cast<std::size_t>(op)] = {left, right}; };
+	for (auto op : {BinaryOp::ASSIGN, BinaryOp::ADD_ASSIGN, BinaryOp::SUB_ASSIGN, BinaryOp::MUL_ASSIGN, BinaryOp::DIV_ASSIGN}) {
+		set(op, 2, 1);
+	}
+	set(BinaryOp::OR, 3, 4);
+	set(BinaryOp::AND, 5, 6);
+	set(BinaryOp::XOR, 7, 8);
+	set(BinaryOp::EQUAL, 9, 10);
+	set(BinaryOp::NOT_EQUAL, 9, 10);
+	for (auto op : {BinaryOp::LESS, BinaryOp::GREATER, BinaryOp::LESS_EQUAL, BinaryOp::GREATER_EQUAL}) {
+		set(op, 11, 12);
+	}
+	set(BinaryOp::ADD, 13, 14);
+	set(BinaryOp::SUB, 13, 14);
+	set(BinaryOp::MUL, 15, 16);
+	set(BinaryOp::DIV, 15, 16);
+	return table;
+}();
+
+constexpr BinaryOp binary_op(std::string_view op) {
+	bool assign = op.size() == 2 && op[1] == '=';
+	switch (op[0]) {
+		case '=': return op.size() == 1 ? BinaryOp::ASSIGN : BinaryOp::EQUAL;
+		case '+': return op.size() == 1 ? BinaryOp::ADD : assign ? BinaryOp::ADD_ASSIGN : BinaryOp::NONE;
+		case '-': return op.size() == 1 ? BinaryOp::SUB : assign ? BinaryOp::SUB_ASSIGN : BinaryOp::NONE;
+		case '*': return op.size() == 1 ? BinaryOp::MUL : BinaryOp::MUL_ASSIGN;
+		case '/': return op.size() == 1 ? BinaryOp::DIV : BinaryOp::DIV_ASSIGN;
+		case '<': return assign ? BinaryOp::LESS_EQUAL : BinaryOp::LESS;
+		case '>': return assign ? BinaryOp::GREATER_EQUAL : BinaryOp::GREATER;
+		case '!': return assign ? BinaryOp::NOT_EQUAL : BinaryOp::NONE;
+		case '|': return op.size() == 2 ? BinaryOp::OR : BinaryOp::NONE;
+		case '&': return op.size() == 2 ? BinaryOp::AND : BinaryOp::NONE;
+		case '^': return BinaryOp::XOR;
+		default: return BinaryOp::NONE;
+	}
+}
+
+static_assert(binary_op("+=") == BinaryOp::ADD_ASSIGN && binary_op("++") == BinaryOp::NONE && binary_op("!") == BinaryOp::NONE);
+
+}
+
+//разбор Пратта: оператор продолжает выражение, пока его левая сила не меньше min_power
+expr Parser::parse_binary_expression(int min_power) {
 	auto lhs = parse_base_expression();
 
-	for (auto op = tokens[offset].value; operators.contains(op) && operators.at(op) >= min_precedence; op = tokens[offset].value) {
-		offset++;
-		auto rhs = parse_binary_expression(operators.at(op));
-		lhs = std::make_shared<BinaryNode>(op, lhs, rhs);
+	while (match(TokenType::OPERATOR)) {
+		auto op = lexer.peek().value;
+		auto kind = binary_op(op);
+		auto [left, right] = binding_powers[static_cast<std::size_t>(kind)];
+		if (kind == BinaryOp::NONE || left < min_power) {
+			break;
+		}
+		lexer.next();
+		auto rhs = parse_binary_expression(right);
+		lhs = nodes.binary(op, lhs, rhs, kind > BinaryOp::DIV_ASSIGN);
 	}
 	return lhs;
 }
 
 expr Parser::parse_base_expression() {
-	if (match(TokenType::INT_LITERAL)) {
-		return std::make_shared<IntNode>(std::stod(extract(TokenType::INT_LITERAL)));
-	}
-	if (match(TokenType::DOUBLE_LITERAL)) {
-		return std::make_shared<DoubleNode>(std::stod(extract(TokenType::DOUBLE_LITERAL)));
-	}
-	if (match(TokenType::CHAR_LITERAL)) {
-		return std::make_shared<CharNode>(extract(TokenType::CHAR_LITERAL));
-	}
-	if (match(TokenType::BOOL_LITERAL)){
-		bool value = true;
-		if(tokens[offset].value == "false"){
-			value = false;
+	switch (lexer.peek().type) {
+		case TokenType::INT_LITERAL:
+			return nodes.integer(extract_number<int>(TokenType::INT_LITERAL));
+		case TokenType::DOUBLE_LITERAL:
+			return nodes.number(extract_number<double>(TokenType::DOUBLE_LITERAL));
+		case TokenType::CHAR_LITERAL:
+			return nodes.character(std::string(lexer.next().value)[0]);
+		case TokenType::BOOL_LITERAL:
+			return nodes.boolean(lexer.next().value == "true");
+		case TokenType::IDENTIFIER: {
+			auto name = lexer.next().id;
+			//spawn f(args) - узел spawn с единственной ветвью-вызовом
+			if (name == symbols::spawn && match(TokenType::IDENTIFIER)) {
+				auto callee = lexer.next().id;
+				std::pmr::vector<expr> call(&arena);
+				call.push_back(arena.make<FunctionNode>(callee, parse_function_interior()));
+				return arena.make<FunctionNode>(name, std::move(call));
+			}
+			if (match(TokenType::LPAREN)) {
+				return arena.make<FunctionNode>(name, parse_function_interior());
+			}
+			auto identifier = nodes.identifier(name);
+			if (auto op = lexer.peek().value; op == "++" || op == "--") {
+				lexer.next();
+				return arena.make<PostfixNode>(std::string(op), identifier);
+			}
+			return identifier;
 		}
-		extract(TokenType::BOOL_LITERAL);
-		return std::make_shared<BoolNode>(value);
-	}
-	else if (match(TokenType::IDENTIFIER)) {
-		if(auto identifier = extract(TokenType::IDENTIFIER); match(TokenType::LPAREN)) {
-			return std::make_shared<FunctionNode>(identifier, parse_function_interior());
-		}else if(tokens[offset] == "++" || tokens[offset] == "--"){
-			auto help = make_shared<IdentifierNode>(identifier);
-			return std::make_shared<PostfixNode>(tokens[offset++].value, help);
-		}else{
-			return std::make_shared<IdentifierNode>(identifier);
+		case TokenType::LPAREN:
+			return parse_parenthesized_expression();
+		case TokenType::OPERATOR: {
+			auto op = lexer.next().value;
+			if (op == "+" || op == "-") {
+				return nodes.unary(op, parse_base_expression());
+			}
+			if (op == "++" || op == "--") {
+				return arena.make<PrefixNode>(std::string(op), nodes.identifier(extract_symbol()));
+			}
+			throw std::runtime_error("Syntax error - unexpected operator " + std::string(op));
 		}
-	}else if(match(TokenType::KEYWORD)){
-		if(tokens[offset] != "false" && tokens[offset] != "true"){
+		case TokenType::KEYWORD:
 			throw std::runtime_error("Parser: Uncorrect expression");
-		}
-	} else if (auto token = tokens[offset++]; token == "+" || token == "-") {
-		return std::make_shared<UnaryNode>(token.value, parse_base_expression());
-	} else if (auto token = tokens[offset]; token == "++" || token == "--") {
-		extract(TokenType::OPERATOR);
-		auto identifier = extract(TokenType::IDENTIFIER);
-		auto help = std::make_shared<IdentifierNode>(identifier);
-		return std::make_shared<PrefixNode>(token.value, help);
-	} else if (match(TokenType::LPAREN)) {
-		return parse_parenthesized_expression();
-	} else {
-		throw std::runtime_error("Syntax error - unexpected token " + tokens[offset].value);
+		default:
+			throw std::runtime_error("Syntax error - unexpected token " + std::string(lexer.peek().value));
 	}
-	return nullptr;
 }
 
 expr Parser::parse_parenthesized_expression() {
 	extract(TokenType::LPAREN);
 	auto node = parse_binary_expression(MIN_PRECEDENCE);
 	extract(TokenType::RPAREN);
-	return std::make_shared<ParenthesizedNode>(node);
+	return nodes.parenthesized(node);
 }
 
-std::vector<expr> Parser::parse_function_interior() {
+std::pmr::vector<expr> Parser::parse_function_interior() {
 	extract(TokenType::LPAREN);
-	std::vector<expr> args;
+	std::pmr::vector<expr> args(&arena);
 	if (!match(TokenType::RPAREN)) {
 		while (true) {
 			args.push_back(parse_identifier_or_digit());
@@ -255,28 +426,53 @@ std::vector<expr> Parser::parse_function_interior() {
 }
 
 expr Parser::parse_identifier_or_digit(){
-	if(tokens[offset].type == TokenType::IDENTIFIER || tokens[offset].type == TokenType::INT_LITERAL || tokens[offset].type == TokenType::DOUBLE_LITERAL ||tokens[offset].type == TokenType::CHAR_LITERAL){
+	if(lexer.peek().type == TokenType::IDENTIFIER || lexer.peek().type == TokenType::INT_LITERAL || lexer.peek().type == TokenType::DOUBLE_LITERAL ||lexer.peek().type == TokenType::CHAR_LITERAL){
 		return parse_binary_expression(MIN_PRECEDENCE);
 	}else{
 		throw std::runtime_error("Not identifier or digit");
 	}
 }
 
-bool Parser::match(TokenType expected_type) const {
-	return tokens[offset] == expected_type;
+bool Parser::match(TokenType expected_type) {
+	return lexer.peek().type == expected_type;
 }
 
 std::string Parser::extract(TokenType expected_type) {
 	if (!match(expected_type)) {
-		std::cout << "Ожидаемый тип: " << static_cast<int>(expected_type) << " Итоговый: "<<static_cast<int>(tokens[offset].type) << std::endl;
-		throw std::runtime_error("Unexpected token " + tokens[offset].value );
+		std::cout << "Ожидаемый тип: " << static_cast<int>(expected_type) << " Итоговый: "<<static_cast<int>(lexer.peek().type) << std::endl;
+		auto [line, column] = lexer.position(lexer.peek());
+		throw std::runtime_error("Unexpected token " + std::string(lexer.peek().value) + " at " + std::to_string(line) + ":" + std::to_string(column));
 	}
-	return tokens[offset++].value;
+	return std::string(lexer.next().value);
 }
 
+template<class T>
+T Parser::extract_number(TokenType expected_type) {
+	if (!match(expected_type)) {
+		extract(expected_type);
+	}
+	auto token = lexer.next();
+	T value{};
+	auto [end, ec] = std::from_chars(token.value.data(), token.value.data() + token.value.size(), value);
+	if (ec != std::errc() || end != token.value.data() + token.value.size()) {
+		auto [line, column] = lexer.position(token);
+		throw std::runtime_error("Number " + std::string(token.value) + " out of range at " + std::to_string(line) + ":" + std::to_string(column));
+	}
+	return value;
+}
+
+symbol Parser::extract_symbol() {
+	if (!match(TokenType::IDENTIFIER)) {
+		extract(TokenType::IDENTIFIER);
+	}
+	return lexer.next().id;
+}
+
+//печатает оставшиеся токены по копии лексера, не сдвигая разбор
 void Parser::print_tokens(){
-	for(int i = 0; i < tokens.size(); i++){
-		switch(tokens[i].type){
+	auto copy = lexer;
+	for(auto type = copy.next().type;; type = copy.next().type){
+		switch(type){
 			case TokenType::KEYWORD :
 				std::cout << "KEYWORD ";
 				break;
@@ -323,13 +519,9 @@ void Parser::print_tokens(){
 				std::cout << "END ";
 				break;
 		}
+		if(type == TokenType::END){
+			break;
+		}
 	}
 	std::cout << std::endl;
 }
-
-const std::unordered_map<std::string, int> Parser::operators = {
-	{"+", 0}, {"-", 0},
-	{"*", 1}, {"/", 1},
-	{"^", 2}, {"<", 2}, {">", 2}, {"==", 2}, {"!=", 2}, {">=", 2}, {"<=", 2}, {"&&", 2}, {"||", 2},
-	{"=", 3}, {"+=", 3}, {"-=", 3}, {"*=", 3}, {"/=", 3}
-};
\ No newline at end of file
@@ -13,7 +13,7 @@ void Printer::visit(VarDefinition& root){
     if(root.const_specifier){
         std::cout << "Const: true" << std::endl;
     }
-    std::cout << "Type: " << root.type << "\nName: " << root.name<< std::endl;
+    std::cout << "Type: " << root.type << "\nName: " << spelling(root.name)<< std::endl;
     std::cout << "Value: ";
     if(root.value != nullptr){
         root.value->accept(*this);
@@ -26,7 +26,7 @@ void Printer::visit(VarDefinition& root){
 void Printer::visit(FuncDefinition& root){
     std::cout << "FuncDefiniton" << std::endl;
     std::cout << "Return type: " << root.returnType << std::endl;
-    std::cout << "Function name: " << root.funcName << std::endl;
+    std::cout << "Function name: " << spelling(root.funcName) << std::endl;
     std::cout << "Args list: ";
 
     if(root.argsList.size() != 0){
@@ -137,7 +137,7 @@ void Printer::visit(UnaryNode& root) {
 }
 
 void Printer::visit(FunctionNode& root) {
-    std::cout << root.name << "(";
+    std::cout << spelling(root.name) << "(";
     for (std::size_t i = 0; i < root.branches.size(); ++i) {
         root.branches[i]->accept(*this);
         if (i != root.branches.size() - 1) {
@@ -148,7 +148,7 @@ void Printer::visit(FunctionNode& root) {
 }
 
 void Printer::visit(IdentifierNode& root) {
-   std::cout << root.name;
+   std::cout << spelling(root.name);
 }
 
 void Printer::visit(IntNode& root) {
@@ -171,4 +171,141 @@ void Printer::visit(ParenthesizedNode& root) {
     std::cout << "(";
     root.expression->accept(*this);
     std::cout << ")";
-}
\ No newline at end of file
+}
+void Printer::print(const FlatAst& ast){
+    for(auto root : ast.roots){
+        print(ast, root);
+        std::cout << std::endl;
+    }
+}
+
+//тот же вывод, что и у visit, но обход идёт по индексам плоского AST
+void Printer::print(const FlatAst& ast, node_id id){
+    auto& root = ast[id];
+    auto optional = [&](node_id child){
+        if(child != no_node){
+            print(ast, child);
+        }else{
+            std::cout << "Empty" << std::endl;
+        }
+    };
+    switch(root.kind){
+        case NodeKind::VAR_DEF:
+            std::cout << "VarDefinition" << std::endl;
+            if(root.constant){
+                std::cout << "Const: true" << std::endl;
+            }
+            std::cout << "Type: " << FlatAst::spelling(root.type) << "\nName: " << spelling(root.a) << std::endl;
+            std::cout << "Value: ";
+            if(root.b != no_node){
+                print(ast, root.b);
+                std::cout << std::endl;
+            }else{
+                std::cout << "Empty" << std::endl;
+            }
+            break;
+        case NodeKind::FUNC_DEF:
+            std::cout << "FuncDefiniton" << std::endl;
+            std::cout << "Return type: " << FlatAst::spelling(root.type) << std::endl;
+            std::cout << "Function name: " << spelling(root.a) << std::endl;
+            std::cout << "Args list: ";
+            if(!ast.list(root.c).empty()){
+                for(auto arg : ast.list(root.c)){
+                    print(ast, arg);
+                }
+            }else{
+                std::cout << "Empty" << std::endl;
+            }
+            std::cout << "Commands:" << std::endl;
+            optional(root.b);
+            break;
+        case NodeKind::EXPR:
+            std::cout << "Expression" << std::endl;
+            print(ast, root.a);
+            std::cout << std::endl;
+            break;
+        case NodeKind::COND:
+            std::cout << "CondStatement" << std::endl;
+            std::cout << "Condition: ";
+            if(root.a != no_node){
+                print(ast, root.a);
+            }
+            std::cout << "\nIf instruction: ";
+            optional(root.b);
+            std::cout << "\nElse instruction: ";
+            optional(root.c);
+            break;
+        case NodeKind::WHILE:
+            std::cout << "WhileLoopStatement" << std::endl;
+            std::cout << "Condition: ";
+            if(root.a != no_node){
+                print(ast, root.a);
+            }else{
+                std::cout << "Empty";
+            }
+            std::cout << "\nCommands: ";
+            optional(root.b);
+            break;
+        case NodeKind::JUMP:
+            std::cout << "JumpStatement" << std::endl;
+            std::cout << "Jump: " << FlatAst::spelling(root.op) << std::endl;
+            std::cout << "Expression: ";
+            optional(root.a);
+            break;
+        case NodeKind::BLOCK:
+            for(auto instruction : ast.list(root.c)){
+                print(ast, instruction);
+            }
+            break;
+        case NodeKind::POSTFIX:
+            std::cout << "PostfixNode\n";
+            print(ast, root.a);
+            std::cout << FlatAst::spelling(root.op) << std::endl;
+            break;
+        case NodeKind::PREFIX:
+            std::cout << "PrefixNode\n" << FlatAst::spelling(root.op);
+            print(ast, root.a);
+            break;
+        case NodeKind::BINARY:
+            print(ast, root.a);
+            std::cout << FlatAst::spelling(root.op);
+            print(ast, root.b);
+            break;
+        case NodeKind::UNARY:
+            std::cout << FlatAst::spelling(root.op);
+            print(ast, root.a);
+            break;
+        case NodeKind::CALL: {
+            std::cout << spelling(root.a) << "(";
+            auto args = ast.list(root.c);
+            for(std::size_t i = 0; i < args.size(); ++i){
+                print(ast, args[i]);
+                if(i != args.size() - 1){
+                    std::cout << ", ";
+                }
+            }
+            std::cout << ")";
+            break;
+        }
+        case NodeKind::IDENTIFIER:
+            std::cout << spelling(root.a);
+            break;
+        case NodeKind::INT:
+            std::cout << ast.integer(id);
+            break;
+        case NodeKind::DOUBLE:
+            std::cout << ast.number(id);
+            break;
+        case NodeKind::CHAR:
+            std::cout << static_cast<char>(root.a);
+            break;
+        case NodeKind::BOOL:
+            std::cout << static_cast<bool>(root.a);
+            break;
+        case NodeKind::PARENTHESIZED:
+            std::cout << "(";
+            print(ast, root.a);
+            std::cout << ")";
+            break;
+    }
+}
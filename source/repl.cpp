@@ -0,0 +1,71 @@
+#include <iostream>
+#include <stdexcept>
+
+#include "repl.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+namespace {
+
+//запись закончена, если последний значащий символ закрывает объявление верхнего уровня
+bool complete(std::string_view text) {
+    auto last = text.find_last_not_of(" \t\r\n");
+    if(last == std::string_view::npos){
+        return false;
+    }
+    auto ends = Parser::declaration_ends(text);
+    return !ends.empty() && ends.back() == last + 1;
+}
+
+}
+
+Repl::Repl(std::istream& input, std::ostream& output) : executor(input, output) {
+    analyzer.open_session();
+    executor.open_session();
+}
+
+bool Repl::submit(std::string_view entry, std::ostream& errors) {
+    Interner::Use use(names);
+    auto point = analyzer.checkpoint();
+    try{
+        auto& text = texts.emplace_back(entry);
+        auto statements = Parser(Lexer(text), arena).parse_statements();
+        for(auto item : statements){
+            if(dynamic_cast<JumpStatement*>(item)){
+                throw std::runtime_error("Jump statement outside of a function");
+            }
+        }
+        analyzer.analyze_entry(statements);
+        executor.execute_entry(statements);
+        return true;
+    }
+    catch(const std::exception& error){
+        analyzer.rollback(point);
+        errors << "error: " << error.what() << std::endl;
+        return false;
+    }
+}
+
+void Repl::run(std::istream& lines, std::ostream& errors, bool prompts) {
+    std::string entry, line;
+    while(true){
+        if(prompts){
+            errors << (entry.empty() ? "> " : ". ") << std::flush;
+        }
+        if(!std::getline(lines, line)){
+            break;
+        }
+        entry += line;
+        entry += '\n';
+        if(complete(entry)){
+            submit(entry, errors);
+            entry.clear();
+        }
+        else if(entry.find_first_not_of(" \t\r\n") == std::string::npos){
+            entry.clear();
+        }
+    }
+    if(!entry.empty() && entry.find_first_not_of(" \t\r\n") != std::string::npos){
+        submit(entry, errors);
+    }
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+
+#include "scheduler.hpp"
+
+namespace {
+
+//поток пула знает свой планировщик и номер своей деки
+thread_local const Scheduler* current_scheduler = nullptr;
+thread_local std::size_t current_worker = 0;
+
+}
+
+Scheduler::Scheduler(unsigned count) {
+    if(count == 0){
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(unsigned i = 0; i < count; i++){
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for(unsigned i = 0; i < count; i++){
+        threads.emplace_back([this, i] { loop(i); });
+    }
+}
+
+Scheduler& Scheduler::shared() {
+    static Scheduler scheduler;
+    return scheduler;
+}
+
+Scheduler::~Scheduler() {
+    wait();
+    {
+        std::lock_guard lock(idle_mutex);
+        stopping = true;
+    }
+    idle.notify_all();
+    threads.clear();//потоки завершаются до того, как разрушатся деки и условная переменная
+}
+
+void Scheduler::submit(Task task) {
+    pending++;
+    auto target = current_scheduler == this ? current_worker : next++ % workers.size();
+    {
+        std::lock_guard lock(workers[target]->mutex);
+        workers[target]->tasks.push_back(std::move(task));
+    }
+    queued++;
+    {
+        std::lock_guard lock(idle_mutex);
+    }
+    idle.notify_one();
+}
+
+bool Scheduler::take(std::size_t self, Task& task) {
+    if(queued == 0){
+        return false;
+    }
+    {
+        auto& own = *workers[self];
+        std::lock_guard lock(own.mutex);
+        if(!own.tasks.empty()){
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    for(std::size_t i = 1; i < workers.size(); i++){
+        auto& victim = *workers[(self + i) % workers.size()];
+        std::lock_guard lock(victim.mutex);
+        if(!victim.tasks.empty()){
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Scheduler::run_one() {
+    auto self = current_scheduler == this ? current_worker : next++ % workers.size();
+    Task task;
+    if(!take(self, task)){
+        return false;
+    }
+    task();
+    if(--pending == 0){
+        {
+            std::lock_guard lock(idle_mutex);
+        }
+        idle.notify_all();
+    }
+    return true;
+}
+
+void Scheduler::loop(std::size_t self) {
+    current_scheduler = this;
+    current_worker = self;
+    while(true){
+        if(run_one()){
+            continue;
+        }
+        std::unique_lock lock(idle_mutex);
+        idle.wait(lock, [this] { return queued > 0 || stopping; });
+        if(stopping && queued == 0){
+            return;
+        }
+    }
+}
+
+void Scheduler::wait() {
+    while(pending > 0){
+        if(run_one()){
+            continue;
+        }
+        std::unique_lock lock(idle_mutex);
+        idle.wait(lock, [this] { return pending == 0 || queued > 0; });
+    }
+}
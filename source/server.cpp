@@ -0,0 +1,333 @@
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "server.hpp"
+#include "cache.hpp"
+
+namespace {
+
+sockaddr_un address(const std::string& path) {
+    sockaddr_un result{};
+    if(path.size() >= sizeof(result.sun_path)){
+        throw std::runtime_error("Socket path is too long: " + path);
+    }
+    result.sun_family = AF_UNIX;
+    std::memcpy(result.sun_path, path.c_str(), path.size() + 1);
+    return result;
+}
+
+void send_all(int fd, std::string_view data) {
+    while(!data.empty()){
+        auto sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if(sent < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            throw std::runtime_error(std::string("Can't send: ") + std::strerror(errno));
+        }
+        data.remove_prefix(sent);
+    }
+}
+
+void send_frame(int fd, std::string_view kind, std::string_view payload) {
+    send_all(fd, std::string(kind) + " " + std::to_string(payload.size()) + "\n");
+    send_all(fd, payload);
+}
+
+//чтение строк заголовков и тел кадров из сокета
+class Connection {
+public:
+    explicit Connection(int fd) : fd(fd) {}
+
+    //пусто в конце потока
+    std::string line() {
+        std::size_t end;
+        while((end = buffered.find('\n')) == std::string::npos){
+            if(!fill()){
+                if(!buffered.empty()){
+                    throw std::runtime_error("Truncated message");
+                }
+                return "";
+            }
+        }
+        auto result = buffered.substr(0, end);
+        buffered.erase(0, end + 1);
+        return result;
+    }
+
+    std::string bytes(std::size_t size) {
+        while(buffered.size() < size){
+            if(!fill()){
+                throw std::runtime_error("Truncated message");
+            }
+        }
+        auto result = buffered.substr(0, size);
+        buffered.erase(0, size);
+        return result;
+    }
+
+    //"<kind> <значение>" -> значение; другое слово - ошибка протокола
+    std::string header(std::string_view kind, std::string& line) {
+        if(!line.starts_with(kind) || line.size() <= kind.size() || line[kind.size()] != ' '){
+            throw std::runtime_error("Expected " + std::string(kind) + ", got '" + line + "'");
+        }
+        return line.substr(kind.size() + 1);
+    }
+
+    std::string frame(std::string_view kind) {
+        auto text = line();
+        return bytes(std::stoull(header(kind, text)));
+    }
+private:
+    bool fill() {
+        std::array<char, 64 * 1024> chunk;
+        while(true){
+            auto got = recv(fd, chunk.data(), chunk.size(), 0);
+            if(got < 0 && errno == EINTR){
+                continue;
+            }
+            if(got < 0){
+                throw std::runtime_error(std::string("Can't receive: ") + std::strerror(errno));
+            }
+            buffered.append(chunk.data(), got);
+            return got > 0;
+        }
+    }
+
+    int fd;
+    std::string buffered;
+};
+
+}
+
+Server::Server(const std::string& path, unsigned threads, std::size_t capacity, unsigned cpu_seconds)
+    : path(path), threads(threads), capacity(std::max<std::size_t>(1, capacity)), cpu_seconds(std::max(1u, cpu_seconds)) {
+    if(this->threads == 0){
+        this->threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto where = address(path);
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(path.c_str());//сокет от прошлого запуска
+    if(listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&where), sizeof(where)) < 0 || listen(listener, SOMAXCONN) < 0){
+        auto error = errno;
+        if(listener >= 0){
+            close(listener);
+        }
+        throw std::runtime_error("Can't listen on " + path + ": " + std::strerror(error));
+    }
+}
+
+Server::~Server() {
+    close(listener);
+    unlink(path.c_str());
+}
+
+void Server::serve() {
+    auto worker = [this] {
+        while(true){
+            int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if(client < 0){
+                continue;
+            }
+            handle(client);
+            close(client);
+        }
+    };
+    std::vector<std::jthread> pool;
+    for(unsigned i = 1; i < threads; i++){
+        pool.emplace_back(worker);
+    }
+    worker();
+}
+
+//тексты с одинаковым содержимым разбираются один раз; одновременная первая сборка одной программы безвредна
+std::shared_ptr<const Program> Server::compile(std::string source, std::uint64_t& id) {
+    id = content_hash(source);
+    if(auto known = find(id)){
+        return known;
+    }
+    std::shared_ptr<const Program> program;
+    {
+        std::shared_lock lock(forking);
+        program = Program::compile(std::move(source));
+    }
+    std::lock_guard lock(mutex);
+    auto [it, added] = programs.try_emplace(id, Entry{std::move(program), {}});
+    if(added){
+        it->second.position = recent.insert(recent.begin(), id);
+        //вытесненная программа живёт, пока её исполняют
+        while(programs.size() > capacity){
+            programs.erase(recent.back());
+            recent.pop_back();
+        }
+    }
+    return it->second.program;
+}
+
+std::shared_ptr<const Program> Server::find(std::uint64_t id) {
+    std::lock_guard lock(mutex);
+    auto it = programs.find(id);
+    if(it == programs.end()){
+        return nullptr;
+    }
+    recent.splice(recent.begin(), recent, it->second.position);
+    return it->second.program;
+}
+
+void Server::handle(int client) {
+    Connection connection(client);
+    try{
+        //запрос читается целиком до ответа: иначе клиент, ещё отправляющий ввод, получит EPIPE вместо ошибки
+        auto line = connection.line();
+        std::shared_ptr<const Program> program;
+        std::uint64_t id = 0;
+        std::string source;
+        if(line.starts_with("program ")){
+            id = std::stoull(connection.header("program", line), nullptr, 16);
+        }
+        else{
+            source = connection.bytes(std::stoull(connection.header("source", line)));
+        }
+        auto input = connection.frame("input");
+        if(line.starts_with("program ")){
+            program = find(id);
+            if(program == nullptr){
+                throw std::runtime_error("Unknown program " + hex(id));
+            }
+        }
+        else{
+            program = compile(std::move(source), id);
+        }
+        send_all(client, "program " + hex(id) + "\n");
+        run(client, std::move(program), input);
+    }
+    catch(const std::exception& error){
+        try{
+            send_frame(client, "error", error.what());
+        }
+        catch(const std::exception&){}
+    }
+}
+
+//дочерний процесс сам отправляет вывод и итог; если он убит сигналом, итог отправляет сервер
+void Server::run(int client, std::shared_ptr<const Program> program, std::string_view input) {
+    pid_t child;
+    {
+        std::unique_lock lock(forking);
+        child = fork();
+    }
+    if(child < 0){
+        throw std::runtime_error(std::string("Can't fork: ") + std::strerror(errno));
+    }
+    if(child == 0){
+        //после мягкого предела приходит SIGXCPU, через секунду после него - SIGKILL
+        rlimit limit{cpu_seconds, cpu_seconds + 1};
+        setrlimit(RLIMIT_CPU, &limit);
+        try{
+            Context context(program, {
+                [&](char* buffer, std::size_t size) {
+                    auto count = input.copy(buffer, size);
+                    input.remove_prefix(count);
+                    return count;
+                },
+                [&](std::string_view text) { send_frame(client, "out", text); }//ушедший клиент прерывает исполнение
+            });
+            context.run();
+            send_all(client, "done\n");
+        }
+        catch(const std::exception& error){
+            try{
+                send_frame(client, "error", error.what());
+            }
+            catch(const std::exception&){}
+        }
+        _exit(0);
+    }
+    //ждём либо конца процесса, либо отключения клиента; иначе бесконечная программа навсегда заняла бы поток пула.
+    //Без pidfd (старые ядра) конец процесса проверяется раз в 100 мс
+    int process = static_cast<int>(syscall(SYS_pidfd_open, child, 0));
+    std::array<pollfd, 2> watched{{{client, POLLRDHUP, 0}, {process, POLLIN, 0}}};
+    int status = 0;
+    bool gone = false;
+    while(true){
+        auto ready = poll(watched.data(), process >= 0 ? 2 : 1, process >= 0 ? -1 : 100);
+        if(ready < 0 && errno != EINTR){
+            while(waitpid(child, &status, 0) < 0 && errno == EINTR){}
+            break;
+        }
+        if(waitpid(child, &status, WNOHANG) == child){
+            break;
+        }
+        if(ready > 0 && watched[0].revents != 0){
+            gone = true;
+            kill(child, SIGKILL);
+            while(waitpid(child, &status, 0) < 0 && errno == EINTR){}
+            break;
+        }
+    }
+    if(process >= 0){
+        close(process);
+    }
+    if(gone){
+        throw std::runtime_error("Client disconnected");
+    }
+    if(WIFSIGNALED(status) && WTERMSIG(status) == SIGXCPU){
+        throw std::runtime_error("Program exceeded the CPU time limit of " + std::to_string(cpu_seconds) + " s");
+    }
+    if(WIFSIGNALED(status)){
+        throw std::runtime_error("Program terminated by signal " + std::to_string(WTERMSIG(status)));
+    }
+}
+
+void request(const std::string& path, std::string_view source, std::istream& input, std::ostream& output) {
+    auto where = address(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&where), sizeof(where)) < 0){
+        auto error = errno;
+        if(fd >= 0){
+            close(fd);
+        }
+        throw std::runtime_error("Can't connect to " + path + ": " + std::strerror(error));
+    }
+    try{
+        std::ostringstream data;
+        data << input.rdbuf();
+        send_frame(fd, "source", source);
+        send_frame(fd, "input", data.str());
+
+        Connection connection(fd);
+        for(auto line = connection.line(); line != "done"; line = connection.line()){
+            if(line.empty()){
+                throw std::runtime_error("Server closed the connection");
+            }
+            if(line.starts_with("program ")){
+                continue;
+            }
+            if(line.starts_with("error ")){
+                throw std::runtime_error(connection.bytes(std::stoull(connection.header("error", line))));
+            }
+            output << connection.bytes(std::stoull(connection.header("out", line)));
+            output.flush();
+        }
+    }
+    catch(...){
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
@@ -0,0 +1,101 @@
+#include <charconv>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "snapshot.hpp"
+#include "cache.hpp"
+#include "flat_ast.hpp"
+
+namespace {
+
+constexpr std::string_view snapshot_version = "snapshot 1";
+
+std::optional<Type> parse_type(const std::string& name) {
+    for(auto type : {Type::INT, Type::DOUBLE, Type::CHAR, Type::BOOL}){
+        if(FlatAst::spelling(type) == name){
+            return type;
+        }
+    }
+    return std::nullopt;
+}
+
+//значение целиком, без хвоста; иначе пусто
+std::optional<operand> parse_value(Type type, const std::string& text) {
+    auto end = text.data() + text.size();
+    if(type == Type::DOUBLE){
+        char* stop = nullptr;
+        auto value = std::strtod(text.c_str(), &stop);
+        return stop == end && !text.empty() ? std::optional<operand>(value) : std::nullopt;
+    }
+    int value = 0;
+    auto [stop, error] = std::from_chars(text.data(), end, value);
+    if(error != std::errc() || stop != end){
+        return std::nullopt;
+    }
+    switch(type){
+        case Type::CHAR: return static_cast<char>(value);
+        case Type::BOOL: return value != 0;
+        default: return value;
+    }
+}
+
+}
+
+void Snapshot::save(const std::string& path, std::uint64_t key) const {
+    auto temp = path + "." + std::to_string(getpid());
+    {
+        std::ofstream out(temp);
+        out << snapshot_version << " " << hex(key) << "\n";
+        out << "output " << output.size() << "\n" << output << "\n";
+        for(auto& global : globals){
+            out << "global " << spelling(global.name) << " " << FlatAst::spelling(global.type) << " ";
+            std::visit([&](auto value) {
+                using T = decltype(value);
+                if constexpr(std::is_same_v<T, double>){
+                    out << std::hexfloat << value << std::defaultfloat;
+                }else{
+                    out << static_cast<int>(value);
+                }
+            }, global.value);
+            out << "\n";
+        }
+        if(!out){
+            throw std::runtime_error("Can't write " + temp);
+        }
+    }
+    std::filesystem::rename(temp, path);//атомарно для параллельных запусков
+}
+
+std::optional<Snapshot> Snapshot::load(const std::string& path, std::uint64_t key) {
+    std::ifstream in(path);
+    std::string version, number, stored, word;
+    if(!(in >> version >> number >> stored) || version + " " + number != snapshot_version || stored != hex(key)){
+        return std::nullopt;
+    }
+    Snapshot snapshot;
+    std::size_t size = 0;
+    if(!(in >> word >> size) || word != "output" || in.get() != '\n'){
+        return std::nullopt;
+    }
+    snapshot.output.resize(size);
+    if(!in.read(snapshot.output.data(), size) || in.get() != '\n'){
+        return std::nullopt;//файл короче заявленного вывода
+    }
+    while(in >> word){
+        std::string name, spelled, value;
+        if(word != "global" || !(in >> name >> spelled >> value)){
+            return std::nullopt;
+        }
+        auto type = parse_type(spelled);
+        auto parsed = type ? parse_value(*type, value) : std::nullopt;
+        if(!parsed){
+            return std::nullopt;
+        }
+        snapshot.globals.push_back({Interner::current().intern(name), *type, *parsed});
+    }
+    return snapshot;
+}
@@ -0,0 +1,41 @@
+#include "symbols.hpp"
+
+Interner::Interner() {
+    intern("print");
+    intern("scan");
+    intern("main");
+    intern("spawn");
+    intern("join");
+}
+
+Interner& Interner::current() {
+    static Interner process;
+    return active != nullptr ? *active : process;
+}
+
+symbol Interner::intern(std::string_view name) {
+    {
+        std::shared_lock lock(mutex);
+        if(auto found = ids.find(name); found != ids.end()){
+            return found->second;
+        }
+    }
+    std::lock_guard lock(mutex);
+    if(auto found = ids.find(name); found != ids.end()){
+        return found->second;
+    }
+    auto id = static_cast<symbol>(names.size());
+    names.emplace_back(name);
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+const std::string& Interner::name(symbol id) {
+    std::shared_lock lock(mutex);
+    return names[id];
+}
+
+std::size_t Interner::size() {
+    std::shared_lock lock(mutex);
+    return names.size();
+}
@@ -0,0 +1,490 @@
+#include <stdexcept>
+#include <type_traits>
+#include <limits>
+
+#include "trace.hpp"
+#include "operations.hpp"
+
+namespace {
+
+//запись трассы прервана; blacklist - больше не пытаться записать этот цикл
+struct TraceAbort {
+    bool blacklist = true;
+};
+
+template<class T>
+T& as(TraceValue& value) {
+    if constexpr (std::is_same_v<T, int>) return value.i;
+    else if constexpr (std::is_same_v<T, double>) return value.d;
+    else if constexpr (std::is_same_v<T, char>) return value.c;
+    else return value.b;
+}
+
+template<class T>
+constexpr Type type_of() {
+    if constexpr (std::is_same_v<T, int>) return Type::INT;
+    else if constexpr (std::is_same_v<T, double>) return Type::DOUBLE;
+    else if constexpr (std::is_same_v<T, char>) return Type::CHAR;
+    else {
+        static_assert(std::is_same_v<T, bool>, "unsupported trace type");
+        return Type::BOOL;
+    }
+}
+
+template<class F>
+void with_type(Type type, F&& f) {
+    switch(type){
+        case Type::INT : f(int{}); break;
+        case Type::DOUBLE : f(double{}); break;
+        case Type::CHAR : f(char{}); break;
+        case Type::BOOL : f(bool{}); break;
+        default : throw TraceAbort{};
+    }
+}
+
+Type type_of(const operand& value) {
+    return std::visit([](auto arg) { return type_of<decltype(arg)>(); }, value);
+}
+
+TraceValue to_value(const operand& value) {
+    TraceValue result{};
+    std::visit([&](auto arg) { as<decltype(arg)>(result) = arg; }, value);
+    return result;
+}
+
+operand to_operand(TraceValue value, Type type) {
+    operand result;
+    with_type(type, [&](auto tag) { result = as<decltype(tag)>(value); });
+    return result;
+}
+
+template<class Op, class L, class R>
+bool binary(TraceFrame& frame, const TraceInstr& instr) {
+    auto value = Op{}(as<L>(frame.slots[instr.lhs]), as<R>(frame.slots[instr.rhs]));
+    as<decltype(value)>(frame.slots[instr.dst]) = value;
+    return true;
+}
+
+template<class Op, class T>
+bool unary(TraceFrame& frame, const TraceInstr& instr) {
+    auto value = Op{}(as<T>(frame.slots[instr.lhs]));
+    as<decltype(value)>(frame.slots[instr.dst]) = value;
+    return true;
+}
+
+template<bool expected>
+bool guard(TraceFrame& frame, const TraceInstr& instr) {
+    return frame.slots[instr.lhs].b == expected;
+}
+
+template<class T>
+bool print(TraceFrame& frame, const TraceInstr& instr) {
+    frame.output.emplace_back(as<T>(frame.slots[instr.lhs]));
+    return true;
+}
+
+template<class Op>
+TraceInstr::handler select_binary(Type lhs, Type rhs, Type& result) {
+    TraceInstr::handler handler = nullptr;
+    with_type(lhs, [&](auto l) {
+        with_type(rhs, [&](auto r) {
+            result = type_of<decltype(Op{}(l, r))>();
+            handler = &binary<Op, decltype(l), decltype(r)>;
+        });
+    });
+    return handler;
+}
+
+template<class Op>
+TraceInstr::handler select_unary(Type type, Type& result) {
+    TraceInstr::handler handler = nullptr;
+    with_type(type, [&](auto tag) {
+        result = type_of<decltype(Op{}(tag))>();
+        handler = &unary<Op, decltype(tag)>;
+    });
+    return handler;
+}
+
+TraceInstr::handler binary_handler(const std::string& op, Type lhs, Type rhs, Type& result) {
+    TraceInstr::handler handler = nullptr;
+    if(!with_binary_operation(op, [&](auto operation) { handler = select_binary<decltype(operation)>(lhs, rhs, result); })){
+        throw TraceAbort{};
+    }
+    return handler;
+}
+
+TraceInstr::handler assignment_handler(const std::string& op, Type lhs, Type rhs, Type& result) {
+    TraceInstr::handler handler = nullptr;
+    if(!with_assignment_operation(op, [&](auto operation) { handler = select_binary<decltype(operation)>(lhs, rhs, result); })){
+        throw TraceAbort{};
+    }
+    return handler;
+}
+
+TraceInstr::handler unary_handler(const std::string& op, Type type, Type& result) {
+    TraceInstr::handler handler = nullptr;
+    if(!with_unary_operation(op, [&](auto operation) { handler = select_unary<decltype(operation)>(type, result); })){
+        throw TraceAbort{};
+    }
+    return handler;
+}
+
+//узлы, вычисление которых не меняет переменных
+bool simple(const expr& node) {
+    return dynamic_cast<IdentifierNode*>(node) || dynamic_cast<IntNode*>(node)
+        || dynamic_cast<DoubleNode*>(node) || dynamic_cast<CharNode*>(node)
+        || dynamic_cast<BoolNode*>(node);
+}
+
+}
+
+Trace::Trace(WhileLoopStatement& loop, const std::function<void(operand&)>& print) : loop(loop), print(print) {}
+
+bool Trace::hot() {
+    if(state == State::BLACKLISTED){
+        return false;
+    }
+    return state == State::RECORDED || ++back_edges >= hot_threshold;
+}
+
+Trace::Exit Trace::enter(const std::shared_ptr<Scope>& scope) {
+    if(state == State::COLD){
+        if(!record(scope)){
+            return Exit::SIDE;
+        }
+        state = State::RECORDED;
+    }else if(!bind(scope)){
+        return Exit::SIDE;
+    }
+    return run();
+}
+
+bool Trace::record(const std::shared_ptr<Scope>& scope) {
+    instructions.clear();
+    inputs.clear();
+    constants.clear();
+    bound.clear();
+    frame.slots.clear();
+    frame.output.clear();
+    try{
+        TraceRecorder recorder(*this, scope);
+        recorder.record();
+    }catch(const TraceAbort& abort){
+        if(abort.blacklist){
+            state = State::BLACKLISTED;
+        }
+        return false;
+    }
+    snapshot.resize(inputs.size());
+    //записанная итерация уже выполнена на слотах
+    flush();
+    write_back();
+    return true;
+}
+
+bool Trace::bind(const std::shared_ptr<Scope>& scope) {
+    bound.clear();
+    for(const auto& input : inputs){
+        auto value = scope->get_value(input.name);
+        if(value == nullptr || type_of(*value) != input.type){
+            return false;
+        }
+        bound.push_back(value);
+        frame.slots[input.slot] = to_value(*value);
+    }
+    for(const auto& [slot, value] : constants){
+        frame.slots[slot] = value;
+    }
+    return true;
+}
+
+Trace::Exit Trace::run() {
+    const auto size = instructions.size();
+    while(true){
+        for(std::size_t i = 0; i < inputs.size(); i++){
+            snapshot[i] = frame.slots[inputs[i].slot];
+        }
+        std::size_t pc = 0;
+        while(pc < size && instructions[pc].op(frame, instructions[pc])){
+            pc++;
+        }
+        if(pc == size){
+            flush();
+            continue;
+        }
+        if(pc == header_guard){
+            flush();
+            write_back();
+            return Exit::LOOP;
+        }
+        //guard внутри тела: откатываем итерацию, её заново выполнит интерпретатор
+        for(std::size_t i = 0; i < inputs.size(); i++){
+            frame.slots[inputs[i].slot] = snapshot[i];
+        }
+        frame.output.clear();
+        write_back();
+        return Exit::SIDE;
+    }
+}
+
+void Trace::flush() {
+    for(auto& value : frame.output){
+        print(value);
+    }
+    frame.output.clear();
+}
+
+void Trace::write_back() {
+    for(std::size_t i = 0; i < inputs.size(); i++){
+        *bound[i] = to_operand(frame.slots[inputs[i].slot], inputs[i].type);
+    }
+}
+
+/////////////////////////////////////////////////////////////////RECORDER/////////////////////////////////////////////////////////////////////////
+TraceRecorder::TraceRecorder(Trace& trace, const std::shared_ptr<Scope>& scope) : trace(trace), scope(scope) {}
+
+void TraceRecorder::record() {
+    trace.loop.condition->accept(*this);
+    if(types[curr] != Type::BOOL){
+        throw TraceAbort{};
+    }
+    if(!trace.frame.slots[curr].b){
+        throw TraceAbort{false};
+    }
+    emit(&guard<true>, 0, curr);
+    trace.header_guard = trace.instructions.size() - 1;
+
+    locals.emplace_back();
+    if(trace.loop.instructions != nullptr){
+        trace.loop.instructions->accept(*this);
+    }
+    locals.pop_back();
+
+    //трасса замыкается только если типы переменных не изменились за итерацию
+    for(const auto& input : trace.inputs){
+        if(types[input.slot] != input.type){
+            throw TraceAbort{};
+        }
+    }
+}
+
+std::uint16_t TraceRecorder::slot(Type type, bool variable) {
+    if(types.size() == std::numeric_limits<std::uint16_t>::max()){
+        throw TraceAbort{};
+    }
+    types.push_back(type);
+    named.push_back(variable);
+    trace.frame.slots.emplace_back();
+    return types.size() - 1;
+}
+
+std::uint16_t TraceRecorder::constant(TraceValue value, Type type) {
+    auto index = slot(type);
+    trace.frame.slots[index] = value;
+    trace.constants.emplace_back(index, value);
+    return index;
+}
+
+std::uint16_t TraceRecorder::copy(std::uint16_t source) {
+    Type type;
+    auto handler = unary_handler("+", types[source], type);
+    auto index = slot(type);
+    emit(handler, index, source);
+    return index;
+}
+
+void TraceRecorder::emit(TraceInstr::handler op, std::uint16_t dst, std::uint16_t lhs, std::uint16_t rhs) {
+    trace.instructions.push_back(TraceInstr{op, dst, lhs, rhs});
+    op(trace.frame, trace.instructions.back());
+}
+
+void TraceRecorder::step(const std::string& op) {
+    if(var < 0){
+        throw TraceAbort{};
+    }
+    Type type;
+    auto handler = unary_handler(op, types[var], type);
+    if(op == "++" || op == "--"){
+        emit(handler, var, var);
+        types[var] = type;
+        curr = var;
+    }else{
+        curr = slot(type);
+        emit(handler, curr, var);
+    }
+}
+
+void TraceRecorder::visit(BinaryNode& root) {
+    root.left_branch->accept(*this);
+    auto lhs = curr;
+    auto target = var;
+    if(root.op != "=" && named[lhs] && !simple(root.right_branch)){
+        lhs = copy(lhs);
+    }
+    root.right_branch->accept(*this);
+    auto rhs = curr;
+    Type type;
+    if(Analyzer::assignment_operations.contains(root.op)){
+        if(target < 0){
+            throw TraceAbort{};
+        }
+        auto handler = assignment_handler(root.op, types[lhs], types[rhs], type);
+        emit(handler, target, lhs, rhs);
+        types[target] = type;
+        curr = rhs;
+    }else{
+        auto handler = binary_handler(root.op, types[lhs], types[rhs], type);
+        curr = slot(type);
+        emit(handler, curr, lhs, rhs);
+    }
+}
+
+void TraceRecorder::visit(UnaryNode& root) {
+    root.branch->accept(*this);
+    Type type;
+    auto handler = unary_handler(root.op, types[curr], type);
+    auto source = curr;
+    curr = slot(type);
+    emit(handler, curr, source);
+}
+
+void TraceRecorder::visit(PostfixNode& root) {
+    root.branch->accept(*this);
+    step(root.op);
+}
+
+void TraceRecorder::visit(PrefixNode& root) {
+    root.branch->accept(*this);
+    step(root.op);
+}
+
+void TraceRecorder::visit(FunctionNode& root) {
+    if(root.name != symbols::print){
+        throw TraceAbort{};
+    }
+    for(std::size_t i = 0; i < root.branches.size(); i++){
+        root.branches[i]->accept(*this);
+        TraceInstr::handler handler = nullptr;
+        with_type(types[curr], [&](auto tag) { handler = &print<decltype(tag)>; });
+        emit(handler, 0, curr);
+    }
+}
+
+void TraceRecorder::visit(IdentifierNode& root) {
+    for(auto it = locals.rbegin(); it != locals.rend(); ++it){
+        if(auto found = it->find(root.name); found != it->end()){
+            curr = found->second;
+            var = curr;
+            return;
+        }
+    }
+    if(!inputs.contains(root.name)){
+        auto value = scope->get_value(root.name);
+        if(value == nullptr){
+            throw TraceAbort{};
+        }
+        auto type = type_of(*value);
+        auto index = slot(type, true);
+        trace.frame.slots[index] = to_value(*value);
+        trace.inputs.push_back(Trace::Input{root.name, index, type});
+        trace.bound.push_back(value);
+        inputs[root.name] = index;
+    }
+    curr = inputs[root.name];
+    var = curr;
+}
+
+void TraceRecorder::visit(IntNode& root) {
+    curr = constant(TraceValue{.i = root.value}, Type::INT);
+    var = -1;
+}
+
+void TraceRecorder::visit(DoubleNode& root) {
+    curr = constant(TraceValue{.d = root.value}, Type::DOUBLE);
+    var = -1;
+}
+
+void TraceRecorder::visit(CharNode& root) {
+    curr = constant(TraceValue{.c = root.value}, Type::CHAR);
+    var = -1;
+}
+
+void TraceRecorder::visit(BoolNode& root) {
+    curr = constant(TraceValue{.b = root.value}, Type::BOOL);
+    var = -1;
+}
+
+void TraceRecorder::visit(ParenthesizedNode& root) {
+    root.expression->accept(*this);
+}
+
+void TraceRecorder::visit(VarDefinition& root) {
+    std::uint16_t source;
+    if(root.value){
+        root.value->accept(*this);
+        source = curr;
+    }else{
+        auto type = Executor::get_type(root.type);
+        source = constant(to_value(Executor::default_value(type)), type);
+    }
+    if(locals.back().contains(root.name)){
+        throw TraceAbort{};
+    }
+    auto index = slot(types[source], true);
+    Type type;
+    emit(assignment_handler("=", types[source], types[source], type), index, index, source);
+    locals.back()[root.name] = index;
+}
+
+void TraceRecorder::visit(ExprStatement& root) {
+    root.expression->accept(*this);
+}
+
+void TraceRecorder::visit(CondStatement& root) {
+    root.condition->accept(*this);
+    if(types[curr] != Type::BOOL){
+        throw TraceAbort{};
+    }
+    if(trace.frame.slots[curr].b){
+        emit(&guard<true>, 0, curr);
+        locals.emplace_back();
+        if(root.if_instruction){
+            root.if_instruction->accept(*this);
+        }
+        locals.pop_back();
+    }else{
+        emit(&guard<false>, 0, curr);
+        if(root.else_instruction){
+            root.else_instruction->accept(*this);
+        }
+    }
+}
+
+void TraceRecorder::visit(BlockStatement& root) {
+    for(std::size_t i = 0; i < root.instructions.size(); i++){
+        root.instructions[i]->accept(*this);
+    }
+}
+
+void TraceRecorder::visit(VarDeclStatement& root) {
+    root.var->accept(*this);
+}
+
+void TraceRecorder::visit(ForLoopStatement&) {}
+
+//вложенные циклы, переходы и вызовы функций трассируются отдельно либо не трассируются
+void TraceRecorder::visit(WhileLoopStatement&) {
+    throw TraceAbort{};
+}
+
+void TraceRecorder::visit(JumpStatement&) {
+    throw TraceAbort{};
+}
+
+void TraceRecorder::visit(FuncDefinition&) {
+    throw TraceAbort{};
+}
+
+void TraceRecorder::visit(FuncDeclStatement&) {
+    throw TraceAbort{};
+}
@@ -0,0 +1,361 @@
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "visitor.hpp"
+#include "cache.hpp"
+
+namespace {
+
+//сам компилятор по PATH, как его найдёт execvp: после обновления меняются размер или время изменения файла
+std::string compiler_identity(const std::string& program){
+    std::vector<std::filesystem::path> candidates;
+    if(program.find('/') != std::string::npos){
+        candidates.push_back(program);
+    }
+    else if(auto path = std::getenv("PATH")){
+        std::istringstream dirs(path);
+        for(std::string dir; std::getline(dirs, dir, ':');){
+            candidates.push_back(std::filesystem::path(dir.empty() ? "." : dir) / program);
+        }
+    }
+    for(auto& candidate : candidates){
+        std::error_code error;
+        auto real = std::filesystem::canonical(candidate, error);
+        if(error || access(real.c_str(), X_OK) != 0){
+            continue;
+        }
+        auto size = std::filesystem::file_size(real, error);
+        auto time = std::filesystem::last_write_time(real, error).time_since_epoch().count();
+        return real.string() + " " + std::to_string(size) + " " + std::to_string(time);
+    }
+    return program;
+}
+
+//код завершения команды или -1; запускается без оболочки, поэтому кавычки в путях ничего не ломают
+int run_command(const std::vector<std::string>& args){
+    std::vector<char*> argv;
+    for(auto& arg : args){
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    auto child = fork();
+    if(child < 0){
+        return -1;
+    }
+    if(child == 0){
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    while(waitpid(child, &status, 0) < 0){
+        if(errno != EINTR){
+            return -1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+}
+
+std::string Transpiler::transpile(const std::vector<statement>& root){
+    out.str("");
+    depth = 0;
+    out << runtime;
+    for(std::size_t i = 0; i < root.size(); i++){
+        if(auto decl = dynamic_cast<FuncDeclStatement*>(root[i])){
+            signature(*decl->func);
+            out << ";\n";
+        }
+    }
+    out << "\n";
+    for(std::size_t i = 0; i < root.size(); i++){
+        global = true;
+        root[i]->accept(*this);
+    }
+    out << "\nint main() {\n    v_main();\n    return 0;\n}\n";
+    return out.str();
+}
+
+std::string Transpiler::build(const std::string& code){
+    //CXX может содержать флаги, как в make: слова через пробел
+    std::vector<std::string> command;
+    std::istringstream words(std::getenv("CXX") ? std::getenv("CXX") : "g++");
+    for(std::string word; words >> word;){
+        command.push_back(word);
+    }
+    if(command.empty()){
+        command.push_back("g++");
+    }
+    command.insert(command.end(), {"-O2", "-std=c++20", "-w"});
+
+    //бинарник зависит не только от кода, но и от компилятора с флагами
+    auto key = content_hash(compiler_identity(command.front()));
+    for(auto& word : command){
+        key = content_hash(word + "\n", key);
+    }
+    auto name = hex(content_hash(code, key));
+    auto dir = cache_directory();
+
+    auto binary = dir / name;
+    if(std::filesystem::exists(binary)){
+        return binary;
+    }
+    auto suffix = "." + std::to_string(getpid());
+    auto source = dir / (name + suffix + ".cpp");
+    auto temp = dir / (name + suffix);
+    {
+        std::ofstream out(source);
+        out << code;
+        out.close();
+        if(!out){
+            std::filesystem::remove(source);
+            throw std::runtime_error("Can't write " + source.string());
+        }
+    }
+
+    command.insert(command.end(), {"-o", temp.string(), source.string()});
+    auto status = run_command(command);
+    std::filesystem::remove(source);
+    if(status != 0){
+        std::string line;
+        for(auto& word : command){
+            line += (line.empty() ? "" : " ") + word;
+        }
+        throw std::runtime_error("Native compilation failed: " + line);
+    }
+    std::filesystem::rename(temp, binary);//атомарно для параллельных сборок одного исходника
+    return binary;
+}
+
+void Transpiler::signature(FuncDefinition& root){
+    out << root.returnType << " v_" << spelling(root.funcName) << "(";
+    for(std::size_t i = 0; i < root.argsList.size(); i++){
+        auto& arg = *root.argsList[i];
+        out << (i ? ", " : "") << (arg.const_specifier ? "const " : "") << arg.type << " v_" << spelling(arg.name);
+    }
+    out << ")";
+}
+
+void Transpiler::body(const statement& root){
+    if(root == nullptr){
+        out << "{}\n";
+        return;
+    }
+    root->accept(*this);
+}
+
+void Transpiler::indent(){
+    for(int i = 0; i < depth; i++){
+        out << "    ";
+    }
+}
+
+void Transpiler::visit(VarDefinition& root){
+    indent();
+    out << (global ? "static " : "") << (root.const_specifier ? "const " : "") << root.type << " v_" << spelling(root.name);
+    if(root.value != nullptr){
+        out << " = ";
+        root.value->accept(*this);
+    }else{
+        out << "{}";
+    }
+    out << ";\n";
+}
+
+void Transpiler::visit(FuncDefinition& root){
+    if(!global){
+        throw std::runtime_error("Nested function " + spelling(root.funcName) + " can't be transpiled");
+    }
+    global = false;
+    signature(root);
+    out << " ";
+    body(root.commandsList);
+    out << "\n";
+}
+
+void Transpiler::visit(ExprStatement& root){
+    indent();
+    root.expression->accept(*this);
+    out << ";\n";
+}
+
+void Transpiler::visit(CondStatement& root){
+    out << "if(";
+    root.condition->accept(*this);
+    out << ") ";
+    body(root.if_instruction);
+    if(root.else_instruction != nullptr){
+        indent();
+        out << "else ";
+        root.else_instruction->accept(*this);
+    }
+}
+
+void Transpiler::visit(ForLoopStatement&){}
+
+void Transpiler::visit(WhileLoopStatement& root){
+    if(root.condition == nullptr){
+        throw std::runtime_error("While loop without condition");
+    }
+    out << "while(";
+    root.condition->accept(*this);
+    out << ") ";
+    body(root.instructions);
+}
+
+void Transpiler::visit(JumpStatement& root){
+    indent();
+    out << root.jumpName;
+    if(root.instructions != nullptr){
+        out << " ";
+        root.instructions->accept(*this);
+    }
+    out << ";\n";
+}
+
+void Transpiler::visit(BlockStatement& root){
+    out << "{\n";
+    depth++;
+    for(std::size_t i = 0; i < root.instructions.size(); i++){
+        auto& instruction = root.instructions[i];
+        if(dynamic_cast<CondStatement*>(instruction) || dynamic_cast<WhileLoopStatement*>(instruction)){
+            indent();
+        }
+        instruction->accept(*this);
+    }
+    depth--;
+    indent();
+    out << "}\n";
+}
+
+void Transpiler::visit(VarDeclStatement& root){
+    root.var->accept(*this);
+}
+
+void Transpiler::visit(FuncDeclStatement& root){
+    root.func->accept(*this);
+}
+
+//постфиксные ++/-- в интерпретаторе возвращают новое значение
+void Transpiler::visit(PostfixNode& root){
+    out << "(" << root.op;
+    root.branch->accept(*this);
+    out << ")";
+}
+
+void Transpiler::visit(PrefixNode& root){
+    out << "(" << root.op;
+    root.branch->accept(*this);
+    out << ")";
+}
+
+void Transpiler::visit(BinaryNode& root){
+    if(!operators.contains(root.op)){
+        throw std::runtime_error("Operator " + root.op + " can't be transpiled");
+    }
+    out << "(";
+    root.left_branch->accept(*this);
+    out << " " << operators.at(root.op) << " ";
+    root.right_branch->accept(*this);
+    out << ")";
+}
+
+void Transpiler::visit(UnaryNode& root){
+    out << "(" << root.op;
+    root.branch->accept(*this);
+    out << ")";
+}
+
+void Transpiler::visit(FunctionNode& root){
+    if(root.name == symbols::spawn || root.name == symbols::join){
+        throw std::runtime_error("Tasks can't be transpiled");
+    }
+    if(root.name == symbols::print || root.name == symbols::scan){
+        out << "(";
+        for(std::size_t i = 0; i < root.branches.size(); i++){
+            out << (i ? ", " : "") << "rt::" << spelling(root.name) << "(";
+            root.branches[i]->accept(*this);
+            out << ")";
+        }
+        out << (root.branches.empty() ? "void()" : "") << ")";
+        return;
+    }
+    out << "v_" << spelling(root.name) << "(";
+    for(std::size_t i = 0; i < root.branches.size(); i++){
+        out << (i ? ", " : "");
+        root.branches[i]->accept(*this);
+    }
+    out << ")";
+}
+
+void Transpiler::visit(IdentifierNode& root){
+    out << "v_" << spelling(root.name);
+}
+
+void Transpiler::visit(IntNode& root){
+    out << root.value;
+}
+
+void Transpiler::visit(DoubleNode& root){
+    char buffer[32];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), root.value);
+    std::string value(buffer, end);
+    if(value.find_first_of(".e") == std::string::npos){
+        value += ".0";
+    }
+    out << value;
+}
+
+void Transpiler::visit(CharNode& root){
+    out << "char(" << static_cast<int>(root.value) << ")";
+}
+
+void Transpiler::visit(BoolNode& root){
+    out << (root.value ? "true" : "false");
+}
+
+void Transpiler::visit(ParenthesizedNode& root){
+    root.expression->accept(*this);
+}
+
+//совпадает с Executor::binary_operations и assignment_operations, включая их текущие '>' и '||'
+const std::unordered_map<std::string, std::string> Transpiler::operators = {
+    {"+", "+"}, {"-", "-"}, {"*", "*"}, {"/", "/"},
+    {"==", "=="}, {"!=", "!="}, {">", "||"}, {">=", ">="}, {"<", "<"}, {"<=", "<="},
+    {"||", "!="}, {"&&", "&&"},
+    {"=", "="}, {"+=", "+="}, {"-=", "-="}, {"*=", "*="}, {"/=", "/="}
+};
+
+const std::string Transpiler::runtime = R"(#include <iostream>
+
+namespace rt {
+    struct Init {
+        Init() {
+            std::ios::sync_with_stdio(false);
+            std::cin.tie(nullptr);
+        }
+    } init;
+
+    template<class T>
+    void print(const T& value) {
+        std::cout << value << '\n';
+    }
+
+    template<class T>
+    void scan(T& value) {
+        std::cout.flush();
+        std::cin >> value;
+    }
+}
+
+)";
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <utility>
+
+#include "workspace.hpp"
+#include "call_graph.hpp"
+#include "parser.hpp"
+
+namespace {
+
+bool blank(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+}
+
+Workspace::Workspace(unsigned threads) : threads(threads) {}
+
+const std::vector<statement>& Workspace::update(std::string_view source) {
+    counters = {};
+    program.clear();
+    for(auto& [text, entry] : entries){
+        entry.live = false;
+    }
+
+    //объявления, текст которых не встречался, разбираются в арену нового поколения
+    std::shared_ptr<Arena> generation;
+    std::vector<Entry*> order;
+    auto ends = Parser::declaration_ends(source);
+    if(std::any_of(source.begin() + (ends.empty() ? 0 : ends.back()), source.end(), [](char c) { return !blank(c); })){
+        ends.push_back(source.size());
+    }
+    std::size_t begin = 0;
+    for(auto end : ends){
+        auto first = begin;
+        while(first < end && blank(source[first])){
+            first++;
+        }
+        auto text = source.substr(first, end - first);
+        begin = end;
+        auto [it, inserted] = entries.try_emplace(std::string(text));
+        auto& entry = it->second;
+        if(inserted){
+            if(generation == nullptr){
+                generation = std::make_shared<Arena>();
+            }
+            try{
+                //лексер идёт по всему исходнику, чтобы позиции в ошибках были настоящими
+                entry.decls = Parser(Lexer(source.substr(0, end), first), *generation).parse();
+            }catch(...){
+                entries.erase(it);
+                throw;
+            }
+            entry.arena = generation;
+            for(auto decl : entry.decls){
+                entry.references.push_back(CallGraph::references(decl));
+            }
+            entry.environments.resize(entry.decls.size());
+            entry.units.resize(entry.decls.size());
+            counters.parsed += entry.decls.size();
+        }
+        entry.live = true;
+        order.push_back(&entry);
+        program.insert(program.end(), entry.decls.begin(), entry.decls.end());
+    }
+    std::erase_if(entries, [](const auto& item) { return !item.second.live; });
+    counters.declarations = program.size();
+
+    //окружение объявления: сигнатуры имён, которые оно видит по порядку, и был ли уже main
+    std::unordered_map<symbol, std::string> visible;
+    bool main_seen = false;
+    std::vector<Analyzer::Unit> units;
+    std::vector<std::string> environments;
+    std::vector<bool> reused;
+    for(auto entry : order){
+        for(std::size_t i = 0; i < entry->decls.size(); i++){
+            auto decl = entry->decls[i];
+            auto func = dynamic_cast<FuncDeclStatement*>(decl);
+            if(func != nullptr){
+                visible.try_emplace(func->func->funcName, Analyzer::signature(decl));
+                main_seen = main_seen || func->func->funcName == symbols::main;
+            }
+            std::string environment = main_seen ? "main;" : ";";
+            for(auto name : entry->references[i]){
+                auto known = visible.find(name);
+                environment += std::to_string(name) + (known != visible.end() ? known->second : "?") + ";";
+            }
+            if(auto var = dynamic_cast<VarDeclStatement*>(decl)){
+                visible.try_emplace(var->var->name, Analyzer::signature(decl));
+            }
+            reused.push_back(entry->units[i].checked && entry->environments[i] == environment);
+            units.push_back(reused.back() ? entry->units[i] : Analyzer::Unit{});
+            environments.push_back(std::move(environment));
+        }
+    }
+
+    //итоги сохраняются и при ошибке: следующая правка перепроверит только то, что изменилось
+    auto store = [&] {
+        std::size_t index = 0;
+        for(auto entry : order){
+            for(std::size_t i = 0; i < entry->decls.size(); i++, index++){
+                if(!reused[index] && units[index].checked){
+                    counters.checked++;
+                }
+                entry->units[i] = std::move(units[index]);
+                entry->environments[i] = std::move(environments[index]);
+            }
+        }
+    };
+    Analyzer analyzer;
+    try{
+        analyzer.analyze_parallel(program, threads, &units);
+    }catch(...){
+        store();
+        throw;
+    }
+    store();
+    return program;
+}